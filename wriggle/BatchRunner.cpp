@@ -0,0 +1,311 @@
+
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "BatchRunner.hpp"
+
+namespace
+{
+// matches * to any run of characters and ? to any one character
+bool MatchesPattern(const std::string& aName, const std::string& aPattern)
+{
+   size_t name = 0;
+   size_t pattern = 0;
+   size_t starPattern = std::string::npos;
+   size_t starName = 0;
+   while (name < aName.size())
+   {
+      if (pattern < aPattern.size() && (aPattern[pattern] == '?' || aPattern[pattern] == aName[name]))
+      {
+         ++name;
+         ++pattern;
+      }
+      else if (pattern < aPattern.size() && aPattern[pattern] == '*')
+      {
+         starPattern = pattern++;
+         starName = name;
+      }
+      else if (starPattern != std::string::npos)
+      {
+         // let the last star take one more character
+         pattern = starPattern + 1;
+         name = ++starName;
+      }
+      else
+      {
+         return false;
+      }
+   }
+   while (pattern < aPattern.size() && aPattern[pattern] == '*')
+   {
+      ++pattern;
+   }
+   return pattern == aPattern.size();
+}
+
+// aText quoted as a JSON string
+std::string JsonString(const std::string& aText)
+{
+   std::string quoted = "\"";
+   for (const char c : aText)
+   {
+      if (c == '"' || c == '\\')
+      {
+         quoted += '\\';
+         quoted += c;
+      }
+      else if (static_cast<unsigned char>(c) < 0x20)
+      {
+         const char* hex = "0123456789abcdef";
+         quoted += "\\u00";
+         quoted += hex[(c >> 4) & 0xf];
+         quoted += hex[c & 0xf];
+      }
+      else
+      {
+         quoted += c;
+      }
+   }
+   return quoted + '"';
+}
+}
+
+std::vector<std::string> BatchRunner::FindPuzzles(const std::string& aSpec)
+{
+   namespace fs = std::filesystem;
+   std::vector<std::string> paths;
+
+   if (aSpec.find_first_of("*?") != std::string::npos)
+   {
+      const fs::path spec{ aSpec };
+      const fs::path dir = spec.has_parent_path() ? spec.parent_path() : fs::path{ "." };
+      const std::string pattern = spec.filename().string();
+      for (const auto& entry : fs::directory_iterator{ dir })
+      {
+         if (entry.is_regular_file() && MatchesPattern(entry.path().filename().string(), pattern))
+         {
+            paths.push_back(entry.path().string());
+         }
+      }
+      std::sort(paths.begin(), paths.end());
+   }
+   else if (fs::is_directory(aSpec))
+   {
+      for (const auto& entry : fs::directory_iterator{ aSpec })
+      {
+         if (entry.is_regular_file())
+         {
+            paths.push_back(entry.path().string());
+         }
+      }
+      std::sort(paths.begin(), paths.end());
+   }
+   else
+   {
+      std::ifstream manifest{ aSpec };
+      if (!manifest)
+      {
+         throw std::runtime_error("cannot read " + aSpec);
+      }
+
+      // blank lines and lines starting with # are skipped
+      const fs::path dir = fs::path{ aSpec }.parent_path();
+      std::string line;
+      while (std::getline(manifest, line))
+      {
+         if (!line.empty() && line.back() == '\r')
+         {
+            line.pop_back();
+         }
+         if (line.empty() || line[0] == '#')
+         {
+            continue;
+         }
+         const fs::path path{ line };
+         paths.push_back(path.is_absolute() ? line : (dir / path).string());
+      }
+   }
+
+   return paths;
+}
+
+void BatchRunner::Run(const std::vector<std::string>& aPaths, std::ostream& aOut, std::ostream& aLog)
+{
+   const auto start = std::chrono::steady_clock::now();
+
+   const size_t jobCount = std::min(static_cast<size_t>(std::max(1, mJobCount)), std::max<size_t>(1, aPaths.size()));
+   for (size_t i = 0; i < jobCount; ++i)
+   {
+      mSlots.push_back(std::make_unique<Slot>());
+   }
+
+   std::thread watcher;
+   if (mTimeout.count() > 0)
+   {
+      watcher = std::thread{ &BatchRunner::Watch, this };
+   }
+
+   std::vector<std::thread> workers;
+   for (size_t i = 1; i < jobCount; ++i)
+   {
+      workers.emplace_back(&BatchRunner::Work, this, std::ref(*mSlots[i]), std::cref(aPaths), std::ref(aOut));
+   }
+   Work(*mSlots.front(), aPaths, aOut);
+   for (auto& worker : workers)
+   {
+      worker.join();
+   }
+
+   mDone = true;
+   if (watcher.joinable())
+   {
+      watcher.join();
+   }
+
+   const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   aLog << "wriggle: " << aPaths.size() << " puzzles in " << seconds << " s, "
+      << (seconds > 0 ? aPaths.size() / seconds : 0.0) << " puzzles/s; "
+      << mSolvedCount << " solved, " << aPaths.size() - mSolvedCount - mTimedOutCount - mLimitCount - mFailedCount
+      << " unsolved, " << mTimedOutCount << " timed out, " << mLimitCount << " stopped by a limit, "
+      << mFailedCount << " failed" << std::endl;
+}
+
+void BatchRunner::Work(Slot& aSlot, const std::vector<std::string>& aPaths, std::ostream& aOut)
+{
+   size_t idx;
+   while ((idx = mNextIdx.fetch_add(1)) < aPaths.size())
+   {
+      const std::string result = Solve(aSlot, aPaths[idx]);
+
+      std::lock_guard<std::mutex> lock{ mOutMutex };
+      aOut << result << std::endl;
+   }
+}
+
+void BatchRunner::Watch()
+{
+   while (!mDone.load())
+   {
+      const auto now = std::chrono::steady_clock::now();
+      for (auto& slotPtr : mSlots)
+      {
+         std::lock_guard<std::mutex> lock{ slotPtr->mMutex };
+         if (slotPtr->mBusy && !slotPtr->mTimedOut && now - slotPtr->mStart >= mTimeout)
+         {
+            slotPtr->mTimedOut = true;
+            if (slotPtr->mSolverPtr)
+            {
+               slotPtr->mSolverPtr->Cancel();
+            }
+         }
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds{ 5 });
+   }
+}
+
+std::string BatchRunner::Solve(Slot& aSlot, const std::string& aPath)
+{
+   // the clock starts before the factory runs, as it may build a pattern
+   // database, which counts against the timeout too
+   {
+      std::lock_guard<std::mutex> lock{ aSlot.mMutex };
+      aSlot.mBusy = true;
+      aSlot.mStart = std::chrono::steady_clock::now();
+      aSlot.mTimedOut = false;
+   }
+
+   std::unique_ptr<Board> initialPtr;
+   std::unique_ptr<Solver> solverPtr;
+   try
+   {
+      Board::Builder builder;
+      builder.FromFile(aPath);
+      initialPtr = std::make_unique<Board>(builder.Build());
+      solverPtr = mFactory(*initialPtr);
+   }
+   catch (const std::exception& aError)
+   {
+      {
+         std::lock_guard<std::mutex> lock{ aSlot.mMutex };
+         aSlot.mBusy = false;
+      }
+      std::lock_guard<std::mutex> lock{ mOutMutex };
+      ++mFailedCount;
+      if (mJsonReport)
+      {
+         return "{\"path\":" + JsonString(aPath) + ",\"status\":\"error\",\"error\":" + JsonString(aError.what()) + "}";
+      }
+      return aPath + "\terror\t0\t0\t" + aError.what();
+   }
+
+   // a puzzle whose time ran out while the solver was made is not searched
+   bool timedOut;
+   {
+      std::lock_guard<std::mutex> lock{ aSlot.mMutex };
+      aSlot.mSolverPtr = solverPtr.get();
+      timedOut = aSlot.mTimedOut;
+   }
+   if (!timedOut)
+   {
+      solverPtr->Exec();
+   }
+   {
+      std::lock_guard<std::mutex> lock{ aSlot.mMutex };
+      aSlot.mBusy = false;
+      aSlot.mSolverPtr = nullptr;
+      timedOut = aSlot.mTimedOut;
+   }
+
+   // an anytime solver keeps the best solution it had when cancelled
+   const bool solved = solverPtr->IsSolved();
+   const std::list<Board::Move>& moves = *solverPtr->GetSolutionMoves();
+   const char* status = solved ? "solved" : timedOut ? "timeout" : solverPtr->IsLimitReached() ? "limit" : "unsolved";
+   std::ostringstream line;
+   if (mJsonReport)
+   {
+      line << "{\"path\":" << JsonString(aPath) << ",\"status\":\"" << status << "\",\"result\":";
+      solverPtr->PrintJson(line);
+      line << '}';
+   }
+   else
+   {
+      line << aPath << '\t' << status << '\t'
+         << (solved ? moves.size() : 0) << '\t'
+         << solverPtr->GetWallTime().count() << '\t';
+   }
+
+   // moves as in Solver::PrintToStream, separated by commas
+   if (solved && !mJsonReport)
+   {
+      Board board = *initialPtr;
+      const char* separator = "";
+      for (const auto& move : moves)
+      {
+         board.MakeMove(move);
+         const Location moveLoc = board.GetSnakePartLocation(move.mSnakeIdx, move.mSnakePart);
+         line << separator << move.mSnakeIdx << ' ' << static_cast<int>(move.mSnakePart) << ' '
+            << moveLoc.GetX() << ' ' << moveLoc.GetY();
+         separator = ",";
+      }
+   }
+
+   std::lock_guard<std::mutex> lock{ mOutMutex };
+   if (solved)
+   {
+      ++mSolvedCount;
+   }
+   else if (timedOut)
+   {
+      ++mTimedOutCount;
+   }
+   else if (solverPtr->IsLimitReached())
+   {
+      ++mLimitCount;
+   }
+   return line.str();
+}
@@ -0,0 +1,96 @@
+
+#ifndef BATCHRUNNER_HPP
+#define BATCHRUNNER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Board.hpp"
+#include "Solver.hpp"
+
+// solves many puzzle files on a pool of worker threads, one puzzle per
+// worker at a time; each result is written as a line as soon as it is
+// known, so the lines come out in the order the puzzles finish
+class BatchRunner
+{
+public:
+   // makes the solver for a puzzle, with every setting applied
+   using SolverFactory = std::function<std::unique_ptr<Solver>(const Board&)>;
+
+   BatchRunner() = delete;
+   BatchRunner(SolverFactory aFactory)
+      : mFactory{ std::move(aFactory) }
+   {}
+
+   void SetJobCount(const int aJobCount)
+   {
+      mJobCount = aJobCount;
+   }
+
+   // a solver still running this long after its puzzle started is
+   // cancelled; zero for no timeout
+   void SetTimeout(const std::chrono::milliseconds aTimeout)
+   {
+      mTimeout = aTimeout;
+   }
+
+   // writes each result as a JSON object holding the path, the status and
+   // Solver::PrintJson, or an error message
+   void SetJsonReport(const bool aJsonReport)
+   {
+      mJsonReport = aJsonReport;
+   }
+
+   // the puzzle files named by aSpec, which is a directory, a pattern with
+   // * and ? over the file names of one directory, or a manifest file that
+   // lists one path per line, relative to the manifest; the files of a
+   // directory or pattern are sorted by name
+   static std::vector<std::string> FindPuzzles(const std::string& aSpec);
+
+   // writes a line per puzzle to aOut: path, status, number of moves, wall
+   // time in ns and the moves, separated by tabs; the totals go to aLog
+   void Run(const std::vector<std::string>& aPaths, std::ostream& aOut, std::ostream& aLog);
+
+private:
+   // the puzzle a worker is solving, watched for the timeout
+   struct Slot
+   {
+      std::mutex mMutex;
+
+      // set from before the solver is made until it is done; the solver
+      // itself is only known once the factory has returned
+      bool mBusy = false;
+      Solver* mSolverPtr = nullptr;
+      std::chrono::steady_clock::time_point mStart;
+      bool mTimedOut = false;
+   };
+
+   void Work(Slot& aSlot, const std::vector<std::string>& aPaths, std::ostream& aOut);
+   void Watch();
+
+   // one result line
+   std::string Solve(Slot& aSlot, const std::string& aPath);
+
+   SolverFactory mFactory;
+   int mJobCount = 1;
+   std::chrono::milliseconds mTimeout{ 0 };
+   bool mJsonReport = false;
+
+   std::vector<std::unique_ptr<Slot>> mSlots;
+   std::atomic<size_t> mNextIdx{ 0 };
+   std::atomic<bool> mDone{ false };
+
+   std::mutex mOutMutex;
+   size_t mSolvedCount = 0;
+   size_t mTimedOutCount = 0;
+   size_t mLimitCount = 0;
+   size_t mFailedCount = 0;
+};
+
+#endif
@@ -0,0 +1,54 @@
+
+#ifndef BITSET_HPP
+#define BITSET_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+// flat, dynamically sized set of bits, one per board cell
+class Bitset
+{
+public:
+   using allocator_type = std::pmr::polymorphic_allocator<std::uint64_t>;
+
+   Bitset() = default;
+   explicit Bitset(const size_t aSize)
+      : mWords((aSize + 63) / 64, 0)
+   {}
+
+   Bitset(const Bitset& aRhs) = default;
+   Bitset(const Bitset& aRhs, const allocator_type& aAlloc)
+      : mWords{ aRhs.mWords, aAlloc }
+   {}
+
+   Bitset(Bitset&& aRhs) = default;
+   Bitset& operator=(const Bitset& aRhs) = default;
+   Bitset& operator=(Bitset&& aRhs) = default;
+
+   bool Test(const size_t aIdx) const
+   {
+      return (mWords[aIdx >> 6] >> (aIdx & 63)) & 1u;
+   }
+
+   void Set(const size_t aIdx)
+   {
+      mWords[aIdx >> 6] |= std::uint64_t{ 1 } << (aIdx & 63);
+   }
+
+   void Reset(const size_t aIdx)
+   {
+      mWords[aIdx >> 6] &= ~(std::uint64_t{ 1 } << (aIdx & 63));
+   }
+
+   bool operator==(const Bitset& aRhs) const
+   {
+      return mWords == aRhs.mWords;
+   }
+
+private:
+   std::pmr::vector<std::uint64_t> mWords;
+};
+
+#endif
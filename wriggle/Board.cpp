@@ -1,8 +1,14 @@
 
+#include <algorithm>
 #include <array>
-#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
 
 #include "Board.hpp"
+#include "MappedFile.hpp"
 
 namespace
 {
@@ -27,6 +33,41 @@ const std::array<Snake::SnakePart, 2> PARTS = { Snake::SnakePart::Head, Snake::S
 const std::array<Direction, 4> DIRECTIONS = { Direction::Up, Direction::Right, Direction::Down, Direction::Left };
 const int ASCII_ZERO = 48;
 
+// cells of a parsed grid hold the input character, or TAIL_BASE plus the
+// snake index for tails written as numbers
+const int TAIL_BASE = 256;
+
+const char BINARY_MAGIC[4] = { 'W', 'P', 'Z', 'L' };
+const std::uint32_t BINARY_VERSION = 1;
+
+// followed by the walls, one bit per cell in row-major order, and then
+// the snakes as they are held in memory
+struct BinaryHeader
+{
+   char mMagic[4];
+   std::uint32_t mVersion;
+   std::uint32_t mSnakeBytes;
+   std::int32_t mWidth;
+   std::int32_t mHeight;
+   std::int32_t mNumSnakes;
+};
+
+bool IsSpace(const char aChar)
+{
+   return aChar == ' ' || aChar == '\n' || aChar == '\r' || aChar == '\t' || aChar == '\v' || aChar == '\f';
+}
+
+bool IsDigit(const char aChar)
+{
+   return aChar >= '0' && aChar <= '9';
+}
+
+// sizes whose cells, border included, fit BoardLayout::MaxCells
+bool IsSizeValid(const std::int64_t aWidth, const std::int64_t aHeight)
+{
+   return aWidth > 0 && aHeight > 0 && (aWidth + 2) * (aHeight + 2) <= BoardLayout::MaxCells;
+}
+
 constexpr Direction NextDirection(const BoardInput aInput)
 {
    switch (aInput)
@@ -67,85 +108,90 @@ bool Board::Move::operator==(const Board::Move& aRhs) const
 
 bool Board::IsLocationEmpty(const Location& aLocation) const
 {
-   return !IsLocationOccupiedByWall(aLocation) && !IsLocationOccupiedBySnake(aLocation);
-   
+   return IsLocationInside(aLocation) && !IsCellBlocked(mLayoutPtr->CellIndex(aLocation));
 }
 
 bool Board::IsLocationInside(const Location& aLocation) const
 {
-   int x = aLocation.GetX();
-   int y = aLocation.GetY();
-   return x >= 0 && x < mSize.GetX() && y >= 0 && y < mSize.GetY();
+   return mLayoutPtr->IsLocationInside(aLocation);
 }
 
 bool Board::IsLocationOccupiedBySnake(const Location& aLocation) const
 {
-   for (const auto& snake : mSnakes)
-   {
-      if (snake.OccupiesLocation(aLocation))
-      {
-         return true;
-      }
-   }
-   return false;
+   return IsLocationInside(aLocation) && mSnakeBits.Test(mLayoutPtr->CellIndex(aLocation));
 }
 
 bool Board::IsLocationOccupiedByWall(const Location& aLocation) const
 {
-   return mWalls.count(aLocation) > 0;
+   return IsLocationInside(aLocation) && mLayoutPtr->IsWall(mLayoutPtr->CellIndex(aLocation));
 }
 
-const Location& Board::GetSnakePartLocation(const int aSnakeIdx, const Snake::SnakePart aSnakePart) const
+Location Board::GetSnakePartLocation(const int aSnakeIdx, const Snake::SnakePart aSnakePart) const
 {
    return mSnakes[aSnakeIdx].GetPartLocation(aSnakePart);
 }
 
 const Location& Board::GetExitLocation() const
 {
-   return mExit;
+   return mLayoutPtr->GetExit();
 }
 
 bool Board::IsSolved() const
 {
-   return mSnakes[0].OccupiesLocation(mExit);
+   return mSnakes[0].OccupiesLocation(mLayoutPtr->GetExit());
 }
 
 std::vector<Board::Move> Board::LegalMoves() const
 {
    std::vector<Move> validMoves;
    validMoves.reserve(2 * 3 * mSnakes.size());
+   LegalMoves(validMoves);
+   return validMoves;
+}
 
+void Board::LegalMoves(std::vector<Move>& aMoves) const
+{
    for (const auto& snake : mSnakes)
    {
       for (const auto part : PARTS)
       {
+         const int partCell = snake.GetPartCell(part);
+         const std::uint8_t open = mLayoutPtr->OpenNeighbors(partCell);
          for (const auto direction : DIRECTIONS)
          {
-            Location tryLoc = snake.GetPartLocation(part).Nudge(direction);
-            if (IsLocationEmpty(tryLoc) && IsLocationInside(tryLoc))
+            // the border is walled, so this also rejects moves off the board
+            if ((open >> static_cast<int>(direction)) & 1u
+               && !mSnakeBits.Test(mLayoutPtr->Neighbor(partCell, direction)))
             {
-               validMoves.push_back({ snake.GetIdx(), part, direction });
+               aMoves.push_back({ snake.GetIdx(), part, direction });
             }
          }
       }
    }
-
-   return validMoves;
 }
 
-void Board::MakeMove(const Move& aMove)
+int Board::MakeMove(const Move& aMove)
 {
-   mSnakes[aMove.mSnakeIdx].MakeMove(aMove.mSnakePart, aMove.mDirection);
+   Snake& snake = mSnakes[aMove.mSnakeIdx];
+   const int oldHead = snake.GetPartCell(Snake::SnakePart::Head);
+   int vacated = snake.MakeMove(aMove.mSnakePart, aMove.mDirection);
+   int entered = snake.GetPartCell(aMove.mSnakePart);
+   mSnakeBits.Reset(vacated);
+   mSnakeBits.Set(entered);
+   mKey ^= mLayoutPtr->ZobristKey(aMove.mSnakeIdx, vacated) ^ mLayoutPtr->ZobristKey(aMove.mSnakeIdx, entered)
+      ^ mLayoutPtr->HeadKey(aMove.mSnakeIdx, oldHead) ^ mLayoutPtr->HeadKey(aMove.mSnakeIdx, snake.GetPartCell(Snake::SnakePart::Head));
+   return vacated;
 }
 
-size_t Board::Hash() const
+void Board::UnmakeMove(const Move& aMove, const int aVacated)
 {
-   size_t hash = 0;
-   for (const auto& snake : mSnakes)
-   {
-      hash = snake.Hash() ^ (hash << 9);
-   }
-   return std::hash<size_t>{}(hash);
+   Snake& snake = mSnakes[aMove.mSnakeIdx];
+   const int oldHead = snake.GetPartCell(Snake::SnakePart::Head);
+   int entered = snake.UnmakeMove(aMove.mSnakePart, aVacated);
+   mSnakeBits.Reset(entered);
+   mSnakeBits.Set(aVacated);
+   mKey ^= mLayoutPtr->ZobristKey(aMove.mSnakeIdx, entered) ^ mLayoutPtr->ZobristKey(aMove.mSnakeIdx, aVacated)
+      ^ mLayoutPtr->HeadKey(aMove.mSnakeIdx, oldHead) ^ mLayoutPtr->HeadKey(aMove.mSnakeIdx, snake.GetPartCell(Snake::SnakePart::Head));
 }
 
 bool Board::operator==(const Board& aRhs) const
@@ -155,68 +201,174 @@ bool Board::operator==(const Board& aRhs) const
 
 void Board::Builder::FromStream(std::istream& aIn)
 {
-   int width;
-   int height;
-   int numSnakes;
-   char input;
-   std::unordered_map<Location, char> textBoard;
+   const std::string text{ std::istreambuf_iterator<char>{ aIn }, std::istreambuf_iterator<char>{} };
+   FromText(text.data(), text.data() + text.size());
+}
 
-   auto TraceSnake = [&textBoard](const Location& aHead) -> Snake
+void Board::Builder::FromFile(const std::string& aPath)
+{
+   const MappedFile file{ aPath };
+   if (IsBinary(file.Data(), file.Size()))
    {
-      Snake::Builder builder;
-      Location loc = aHead;
-      builder.SetHead(loc);
-      auto input = static_cast<BoardInput>(textBoard.at(loc));
-      Direction nextDirection = NextDirection(input);
+      FromBinary(file.Data(), file.Size());
+   }
+   else
+   {
+      FromText(file.Data(), file.Data() + file.Size());
+   }
+}
 
-      while (nextDirection != Direction::Null)
+void Board::Builder::FromText(const char* aBegin, const char* aEnd)
+{
+   const char* pos = aBegin;
+
+   // sets [token, tokenEnd) to the next token; returns false at the end
+   const char* token = nullptr;
+   const char* tokenEnd = nullptr;
+   auto NextToken = [&]()
+   {
+      while (pos != aEnd && IsSpace(*pos))
       {
-         builder.AddSegment(nextDirection);
-         loc = loc.Nudge(nextDirection);
-         input = static_cast<BoardInput>(textBoard.at(loc));
-         nextDirection = NextDirection(input);
+         ++pos;
       }
+      token = pos;
+      while (pos != aEnd && !IsSpace(*pos))
+      {
+         ++pos;
+      }
+      tokenEnd = pos;
+      return token != tokenEnd;
+   };
 
-      builder.SetIndex(static_cast<int>(textBoard.at(loc)) - ASCII_ZERO);
-      return builder.Build();
+   // a decimal number, capped so it cannot overflow; -1 if there is none
+   auto NextNumber = [&]()
+   {
+      if (!NextToken())
+      {
+         return -1;
+      }
+      int number = 0;
+      for (const char* c = token; c != tokenEnd; ++c)
+      {
+         if (!IsDigit(*c))
+         {
+            return -1;
+         }
+         number = std::min(number * 10 + (*c - '0'), UINT16_MAX + 1);
+      }
+      return number;
    };
 
-   aIn >> width;
-   aIn >> height;
-   mBoardPtr->mSize = { width, height };
-   mBoardPtr->mExit = { width - 1, height - 1 };
+   const int width = NextNumber();
+   const int height = NextNumber();
+   const int numSnakes = NextNumber();
+   if (!IsSizeValid(width, height) || numSnakes <= 0 || numSnakes > MaxSnakes)
+   {
+      throw std::runtime_error("malformed puzzle header");
+   }
 
-   aIn >> numSnakes;
-   mBoardPtr->mSnakes.resize(numSnakes);
+   BoardLayout::Builder layoutBuilder;
+   layoutBuilder.SetSize(width, height);
 
+   std::vector<int> cells(static_cast<size_t>(width) * height);
    for (int j = 0; j < height; ++j)
    {
       for (int i = 0; i < width; ++i)
       {
-         aIn >> input;
-         textBoard[{ i, j }] = input;
+         if (!NextToken())
+         {
+            throw std::runtime_error("puzzle grid is incomplete");
+         }
+
+         // single characters are kept as they are, so tails written as
+         // '0' plus the index still work; longer tokens are tail indices
+         int& cell = cells[static_cast<size_t>(j) * width + i];
+         if (tokenEnd - token == 1)
+         {
+            cell = static_cast<unsigned char>(*token);
+         }
+         else if (std::all_of(token, tokenEnd, IsDigit) && tokenEnd - token <= 4)
+         {
+            cell = TAIL_BASE + std::stoi(std::string{ token, tokenEnd });
+         }
+         else
+         {
+            throw std::runtime_error("unknown puzzle cell " + std::string{ token, tokenEnd });
+         }
+
+         if (cell == static_cast<int>(BoardInput::Wall))
+         {
+            layoutBuilder.AddWall({ i, j });
+         }
       }
    }
 
+   Start(layoutBuilder.Build(), numSnakes);
+   const BoardLayout& layout = *mBoardPtr->mLayoutPtr;
+
+   // the trace that last went through each cell, so that a body leading
+   // back onto itself is caught before it grows past Snake::MaxLength
+   std::vector<int> tracedBy(cells.size(), -1);
+   int traceCount = 0;
+   auto TraceSnake = [&](const Location& aHead) -> Snake
+   {
+      const int trace = traceCount++;
+      Snake::Builder builder{ layout.GetStride() };
+      Location loc = aHead;
+      builder.SetHead(loc);
+      size_t at = static_cast<size_t>(loc.GetY()) * width + loc.GetX();
+      tracedBy[at] = trace;
+      int cell = cells[at];
+      Direction nextDirection = NextDirection(static_cast<BoardInput>(cell));
+
+      while (nextDirection != Direction::Null)
+      {
+         loc = loc.Nudge(nextDirection);
+         if (!layout.IsLocationInside(loc))
+         {
+            throw std::runtime_error("snake runs off the board");
+         }
+         at = static_cast<size_t>(loc.GetY()) * width + loc.GetX();
+         if (tracedBy[at] == trace)
+         {
+            throw std::runtime_error("malformed snake");
+         }
+         tracedBy[at] = trace;
+         builder.AddSegment(nextDirection);
+         cell = cells[at];
+         nextDirection = cell < TAIL_BASE ? NextDirection(static_cast<BoardInput>(cell)) : Direction::Null;
+      }
+
+      // a tail in a single character is one digit
+      int idx = -1;
+      if (cell >= TAIL_BASE)
+      {
+         idx = cell - TAIL_BASE;
+      }
+      else if (IsDigit(static_cast<char>(cell)))
+      {
+         idx = cell - ASCII_ZERO;
+      }
+      if (idx < 0 || idx >= numSnakes)
+      {
+         throw std::runtime_error("snake index out of range");
+      }
+      builder.SetIndex(idx);
+      return builder.Build();
+   };
+
    for (int i = 0; i < width; ++i)
    {
       for (int j = 0; j < height; ++j)
       {
-         Location loc{ i, j };
-         Snake snake;
-
-         switch (static_cast<BoardInput>(textBoard[loc]))
+         switch (static_cast<BoardInput>(cells[static_cast<size_t>(j) * width + i]))
          {
-         case BoardInput::Wall:
-            mBoardPtr->mWalls.insert(loc);
-            break;
-
          case BoardInput::HeadUp:
          case BoardInput::HeadRight:
          case BoardInput::HeadDown:
          case BoardInput::HeadLeft:
-            snake = TraceSnake(loc);
-            mBoardPtr->mSnakes[snake.GetIdx()] = snake;
+            PlaceSnake(TraceSnake({ i, j }));
+            break;
 
          default: // ignore all others
             break;
@@ -224,6 +376,135 @@ void Board::Builder::FromStream(std::istream& aIn)
       }
    }
 
+   Finish();
+}
+
+void Board::Builder::FromBinary(const char* aData, const size_t aSize)
+{
+   BinaryHeader header;
+   if (!IsBinary(aData, aSize))
+   {
+      throw std::runtime_error("not a binary puzzle");
+   }
+   else if (aSize < sizeof(header))
+   {
+      throw std::runtime_error("malformed binary puzzle");
+   }
+   std::memcpy(&header, aData, sizeof(header));
+
+   const size_t wallBytes = (static_cast<size_t>(std::max(0, header.mWidth)) * std::max(0, header.mHeight) + 7) / 8;
+   if (header.mVersion != BINARY_VERSION || header.mSnakeBytes != sizeof(Snake)
+      || !IsSizeValid(header.mWidth, header.mHeight) || header.mNumSnakes <= 0 || header.mNumSnakes > MaxSnakes
+      || aSize != sizeof(header) + wallBytes + header.mNumSnakes * sizeof(Snake))
+   {
+      throw std::runtime_error("malformed binary puzzle");
+   }
+
+   BoardLayout::Builder layoutBuilder;
+   layoutBuilder.SetSize(header.mWidth, header.mHeight);
+   const auto* wallsPtr = reinterpret_cast<const unsigned char*>(aData + sizeof(header));
+   for (int j = 0; j < header.mHeight; ++j)
+   {
+      for (int i = 0; i < header.mWidth; ++i)
+      {
+         const size_t bit = static_cast<size_t>(j) * header.mWidth + i;
+         if ((wallsPtr[bit >> 3] >> (bit & 7)) & 1u)
+         {
+            layoutBuilder.AddWall({ i, j });
+         }
+      }
+   }
+   Start(layoutBuilder.Build(), header.mNumSnakes);
+
+   // the bytes are trusted for nothing but their size: the fields a snake
+   // is walked by are checked here, and its cells as it is placed
+   const BoardLayout& layout = *mBoardPtr->mLayoutPtr;
+   auto IsCellValid = [&layout](const int aCell)
+   {
+      return aCell < layout.GetNumCells();
+   };
+   const char* snakesPtr = aData + sizeof(header) + wallBytes;
+   for (int i = 0; i < header.mNumSnakes; ++i)
+   {
+      Snake snake;
+      std::memcpy(static_cast<void*>(&snake), snakesPtr + i * sizeof(Snake), sizeof(Snake));
+      if (snake.GetIdx() != i || snake.GetLength() < 2 || snake.GetLength() > Snake::MaxLength
+         || snake.GetStride() != layout.GetStride() || !IsCellValid(snake.GetPartCell(Snake::SnakePart::Head))
+         || !IsCellValid(snake.GetPartCell(Snake::SnakePart::Tail)) || !snake.IsChainTrimmed())
+      {
+         throw std::runtime_error("malformed binary puzzle");
+      }
+      PlaceSnake(snake);
+   }
+
+   Finish();
+}
+
+bool Board::Builder::IsBinary(const char* aData, const size_t aSize)
+{
+   return aSize >= sizeof(BINARY_MAGIC) && std::memcmp(aData, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0;
+}
+
+void Board::Builder::Start(std::shared_ptr<const BoardLayout> aLayoutPtr, const int aNumSnakes)
+{
+   mBoardPtr = std::make_unique<Board>();
+   mBoardPtr->mLayoutPtr = std::move(aLayoutPtr);
+   mBoardPtr->mSnakes.resize(aNumSnakes);
+   mBoardPtr->mSnakeBits = Bitset(mBoardPtr->mLayoutPtr->GetNumCells());
+}
+
+void Board::Builder::PlaceSnake(const Snake& aSnake)
+{
+   const BoardLayout& layout = *mBoardPtr->mLayoutPtr;
+   const int idx = aSnake.GetIdx();
+   if (idx >= static_cast<int>(mBoardPtr->mSnakes.size()))
+   {
+      throw std::runtime_error("snake index out of range");
+   }
+   else if (mBoardPtr->mSnakes[idx].GetLength() > 0)
+   {
+      throw std::runtime_error("snake index used twice");
+   }
+
+   int cell = -1;
+   for (auto it = aSnake.cbegin(); it != aSnake.cend(); ++it)
+   {
+      const Location loc = *it;
+      if (!layout.IsLocationInside(loc))
+      {
+         throw std::runtime_error("snake runs off the board");
+      }
+      const bool first = cell < 0;
+      cell = layout.CellIndex(loc);
+      if (first && cell != aSnake.GetPartCell(Snake::SnakePart::Head))
+      {
+         throw std::runtime_error("malformed snake");
+      }
+      else if (layout.IsWall(cell) || mBoardPtr->mSnakeBits.Test(cell))
+      {
+         throw std::runtime_error("snake overlaps a wall or another snake");
+      }
+      mBoardPtr->mSnakeBits.Set(cell);
+      mBoardPtr->mKey ^= layout.ZobristKey(idx, cell);
+   }
+   if (cell != aSnake.GetPartCell(Snake::SnakePart::Tail))
+   {
+      throw std::runtime_error("malformed snake");
+   }
+
+   mBoardPtr->mKey ^= layout.HeadKey(idx, aSnake.GetPartCell(Snake::SnakePart::Head));
+   mBoardPtr->mSnakes[idx] = aSnake;
+}
+
+void Board::Builder::Finish()
+{
+   for (size_t i = 0; i < mBoardPtr->mSnakes.size(); ++i)
+   {
+      if (mBoardPtr->mSnakes[i].GetLength() == 0)
+      {
+         throw std::runtime_error("snake " + std::to_string(i) + " is missing");
+      }
+   }
 }
 
 Board Board::Builder::Build()
@@ -233,8 +514,6 @@ Board Board::Builder::Build()
 
 void Board::PrintToStream(std::ostream& aOut) const
 {
-   std::unordered_map<Location, char> output;
-
    auto UnitLocToOutput = [](const Location& aLoc, bool aIsHead = false) -> BoardInput
    {
       BoardInput out;
@@ -263,49 +542,93 @@ void Board::PrintToStream(std::ostream& aOut) const
       return out;
    };
 
+   const int width = mLayoutPtr->GetSize().GetX();
+   const int height = mLayoutPtr->GetSize().GetY();
+   std::vector<char> output(static_cast<size_t>(width) * height, static_cast<char>(BoardInput::EmptySpace));
+   auto At = [&output, width](const Location& aLoc) -> char&
+   {
+      return output[static_cast<size_t>(aLoc.GetY()) * width + aLoc.GetX()];
+   };
+
    // write walls
-   for (const auto& wall : mWalls)
+   for (int j = 0; j < height; ++j)
    {
-      output[wall] = static_cast<char>(BoardInput::Wall);
+      for (int i = 0; i < width; ++i)
+      {
+         if (mLayoutPtr->IsWall(mLayoutPtr->CellIndex({ i, j })))
+         {
+            At({ i, j }) = static_cast<char>(BoardInput::Wall);
+         }
+      }
    }
 
-   // write snakes
+   // write snakes; tails are written as the snake index
    for (const auto& snake : mSnakes)
    {
       auto it = snake.cbegin();
       auto jt = std::next(it);
       Location nextUnitLoc = *jt - *it;
-      output[*it] = static_cast<char>(UnitLocToOutput(nextUnitLoc, true));
+      At(*it) = static_cast<char>(UnitLocToOutput(nextUnitLoc, true));
       ++it;
       ++jt;
       while (jt != snake.cend())
       {
          nextUnitLoc = *jt - *it;
-         output[*it] = static_cast<char>(UnitLocToOutput(nextUnitLoc, false));
+         At(*it) = static_cast<char>(UnitLocToOutput(nextUnitLoc, false));
          ++it;
          ++jt;
       }
-      output[*it] = static_cast<char>(snake.GetIdx() + ASCII_ZERO);
+      At(*it) = snake.GetIdx() < MaxTextSnakes ? static_cast<char>(snake.GetIdx() + ASCII_ZERO) : '*';
    }
 
-   int width = mSize.GetX();
-   int height = mSize.GetY();
-   Location loc;
    for (int j = 0; j < height; ++j)
    {
       for (int i = 0; i < width; ++i)
       {
-         loc = { i, j };
-         if (output.count(loc))
-         {
-            aOut << output[loc] << " ";
-         }
-         else
+         aOut << At({ i, j }) << " ";
+      }
+      aOut << std::endl;
+   }
+
+}
+
+void Board::WriteText(std::ostream& aOut) const
+{
+   if (!FitsText())
+   {
+      throw std::runtime_error("puzzles of more than " + std::to_string(MaxTextSnakes) + " snakes only fit the binary format");
+   }
+   aOut << mLayoutPtr->GetSize().GetX() << ' ' << mLayoutPtr->GetSize().GetY() << ' ' << mSnakes.size() << std::endl;
+   PrintToStream(aOut);
+}
+
+void Board::WriteBinary(std::ostream& aOut) const
+{
+   const int width = mLayoutPtr->GetSize().GetX();
+   const int height = mLayoutPtr->GetSize().GetY();
+
+   BinaryHeader header;
+   std::memcpy(header.mMagic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+   header.mVersion = BINARY_VERSION;
+   header.mSnakeBytes = sizeof(Snake);
+   header.mWidth = width;
+   header.mHeight = height;
+   header.mNumSnakes = static_cast<std::int32_t>(mSnakes.size());
+
+   std::vector<unsigned char> walls((static_cast<size_t>(width) * height + 7) / 8);
+   for (int j = 0; j < height; ++j)
+   {
+      for (int i = 0; i < width; ++i)
+      {
+         const size_t bit = static_cast<size_t>(j) * width + i;
+         if (mLayoutPtr->IsWall(mLayoutPtr->CellIndex({ i, j })))
          {
-            aOut << static_cast<char>(BoardInput::EmptySpace) << " ";
+            walls[bit >> 3] = static_cast<unsigned char>(walls[bit >> 3] | (1u << (bit & 7)));
          }
       }
-      aOut << std::endl;
    }
 
+   aOut.write(reinterpret_cast<const char*>(&header), sizeof(header));
+   aOut.write(reinterpret_cast<const char*>(walls.data()), static_cast<std::streamsize>(walls.size()));
+   aOut.write(static_cast<const char*>(GetStateData()), static_cast<std::streamsize>(GetStateBytes()));
 }
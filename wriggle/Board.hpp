@@ -2,15 +2,22 @@
 #ifndef PUZZLEFILE_HPP
 #define PUZZLEFILE_HPP
 
+#include <cstdint>
 #include <iostream>
 #include <list>
 #include <memory>
+#include <memory_resource>
+#include <string>
 #include <unordered_set>
 #include <vector>
 
+#include "Bitset.hpp"
+#include "BoardLayout.hpp"
 #include "Location.hpp"
 #include "Snake.hpp"
 
+// the dynamic state of a puzzle: the snakes and the cells they occupy,
+// on top of a layout shared by every state of a search
 class Board
 {
 public:
@@ -22,35 +29,106 @@ public:
       Direction mDirection;
 
       bool operator==(const Move& aRhs) const;
+
+      // snake index, part and direction in 16 bits, for compact search nodes
+      std::uint16_t Pack() const
+      {
+         return static_cast<std::uint16_t>((mSnakeIdx << 3) | (static_cast<int>(mSnakePart) << 2) | static_cast<int>(mDirection));
+      }
+
+      static Move Unpack(const std::uint16_t aPacked)
+      {
+         return { aPacked >> 3, static_cast<Snake::SnakePart>((aPacked >> 2) & 1), static_cast<Direction>(aPacked & 3) };
+      }
    };
 
+   using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+   // snake indices are kept in a byte
+   static constexpr int MaxSnakes = 256;
+
+   // tails are written as one digit, so the text format holds at most this
+   // many snakes; larger puzzles are written with WriteBinary
+   static constexpr int MaxTextSnakes = 10;
+
    Board() = default;
    Board(const Board& aRhs) = default;
 
+   // copies the snake state into memory from aAlloc, e.g. a solver's arena
+   Board(const Board& aRhs, const allocator_type& aAlloc)
+      : mLayoutPtr{ aRhs.mLayoutPtr }
+      , mSnakes{ aRhs.mSnakes, aAlloc }
+      , mSnakeBits{ aRhs.mSnakeBits, aAlloc }
+      , mKey{ aRhs.mKey }
+   {}
+
+   Board& operator=(const Board& aRhs) = default;
+
+   // locations outside the board are never empty
    bool IsLocationEmpty(const Location& aLocation) const;
    bool IsLocationInside(const Location& aLocation) const;
    bool IsLocationOccupiedBySnake(const Location& aLocation) const;
    bool IsLocationOccupiedByWall(const Location& aLocation) const;
 
-   const Location& GetSnakePartLocation(const int aSnakeIdx, const Snake::SnakePart aSnakePart) const;
+   bool IsCellOccupiedBySnake(const int aCell) const
+   {
+      return mSnakeBits.Test(aCell);
+   }
+
+   const BoardLayout& GetLayout() const { return *mLayoutPtr; }
+   const Snake& GetSnake(const int aSnakeIdx) const { return mSnakes[aSnakeIdx]; }
+   Location GetSnakePartLocation(const int aSnakeIdx, const Snake::SnakePart aSnakePart) const;
    const Location& GetExitLocation() const;
 
    bool IsSolved() const;
 
    std::vector<Move> LegalMoves() const;
-   void MakeMove(const Move& aMove);
 
-   size_t Hash() const;
+   // appends the legal moves to aMoves, so a caller can reuse its storage
+   void LegalMoves(std::vector<Move>& aMoves) const;
+
+   // returns the cell vacated by the move, which UnmakeMove needs to take
+   // the move back
+   int MakeMove(const Move& aMove);
+   void UnmakeMove(const Move& aMove, const int aVacated);
+
+   size_t Hash() const { return static_cast<size_t>(mKey); }
+
+   // the snakes as raw bytes, which fully determine the state on a layout
+   const void* GetStateData() const { return mSnakes.data(); }
+   size_t GetStateBytes() const { return mSnakes.size() * sizeof(Snake); }
 
    bool operator==(const Board& aRhs) const;
 
+   // the grid in the text format, one character per cell, tails written
+   // as the snake index; tails past MaxTextSnakes are shown as '*', which
+   // does not parse
    void PrintToStream(std::ostream& aOut) const;
 
+   bool FitsText() const { return mSnakes.size() <= MaxTextSnakes; }
+
+   // the whole puzzle in the text format, header included; throws
+   // std::runtime_error if the puzzle does not fit it
+   void WriteText(std::ostream& aOut) const;
+
+   // the walls as a bitmap and the snakes as they are held in memory, in
+   // host byte order; loads with next to no parsing
+   void WriteBinary(std::ostream& aOut) const;
+
 private:
-   Location mSize;
-   Location mExit;
-   std::vector<Snake> mSnakes;
-   std::unordered_set<Location> mWalls;
+   bool IsCellBlocked(const int aCellIdx) const
+   {
+      return mLayoutPtr->IsWall(aCellIdx) || mSnakeBits.Test(aCellIdx);
+   }
+
+   std::shared_ptr<const BoardLayout> mLayoutPtr;
+   std::pmr::vector<Snake> mSnakes;
+
+   // snake occupancy layer, one bit per layout cell
+   Bitset mSnakeBits;
+
+   // Zobrist key, kept up to date by MakeMove
+   std::uint64_t mKey = 0;
 
 public:
    class Builder
@@ -61,9 +139,32 @@ public:
       {}
 
       Board Build();
+
+      // the text format; tails may be written as '0' plus the index or as
+      // a decimal index. every reader throws std::runtime_error on a
+      // malformed puzzle
       void FromStream(std::istream& aIn);
+      void FromText(const char* aBegin, const char* aEnd);
+
+      // the format of Board::WriteBinary
+      void FromBinary(const char* aData, const size_t aSize);
+
+      // either format, told apart by the binary header; the file is mapped
+      // into memory rather than read through a stream
+      void FromFile(const std::string& aPath);
+
+      static bool IsBinary(const char* aData, const size_t aSize);
 
    private:
+      // a board on the layout with no snakes placed yet
+      void Start(std::shared_ptr<const BoardLayout> aLayoutPtr, const int aNumSnakes);
+
+      // checks the snake against the walls and the snakes placed so far
+      void PlaceSnake(const Snake& aSnake);
+
+      // checks that every snake was placed
+      void Finish();
+
       std::unique_ptr<Board> mBoardPtr;
    };
 };
@@ -0,0 +1,106 @@
+
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+#include "BoardLayout.hpp"
+#include "Snake.hpp"
+
+namespace
+{
+// fixed seed so hashes are reproducible between runs
+const std::uint64_t ZOBRIST_SEED = 0x5EED5EED5EED5EEDull;
+
+std::uint64_t SplitMix64(std::uint64_t& aState)
+{
+   std::uint64_t z = (aState += 0x9E3779B97F4A7C15ull);
+   z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+   z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+   return z ^ (z >> 31);
+}
+}
+
+void BoardLayout::Builder::SetSize(const int aWidth, const int aHeight)
+{
+   BoardLayout& layout = *mLayoutPtr;
+   layout.mSize = { aWidth, aHeight };
+   layout.mExit = { aWidth - 1, aHeight - 1 };
+   layout.mStride = aWidth + 2;
+   layout.mNumCells = (aWidth + 2) * (aHeight + 2);
+   if (layout.mNumCells > MaxCells)
+   {
+      throw std::length_error("board is too large");
+   }
+
+   layout.mWallBits = Bitset(layout.mNumCells);
+   for (int i = -1; i <= aWidth; ++i)
+   {
+      layout.mWallBits.Set(layout.CellIndex({ i, -1 }));
+      layout.mWallBits.Set(layout.CellIndex({ i, aHeight }));
+   }
+   for (int j = 0; j < aHeight; ++j)
+   {
+      layout.mWallBits.Set(layout.CellIndex({ -1, j }));
+      layout.mWallBits.Set(layout.CellIndex({ aWidth, j }));
+   }
+}
+
+void BoardLayout::Builder::AddWall(const Location& aLocation)
+{
+   mLayoutPtr->mWallBits.Set(mLayoutPtr->CellIndex(aLocation));
+}
+
+std::shared_ptr<const BoardLayout> BoardLayout::Builder::Build()
+{
+   BoardLayout& layout = *mLayoutPtr;
+   for (int dir = 0; dir < 4; ++dir)
+   {
+      layout.mOffsets[dir] = Snake::CellOffset(static_cast<Direction>(dir), layout.mStride);
+   }
+
+   // skip the top and bottom border rows so every neighbor index is in range
+   layout.mOpenNeighbors.assign(layout.mNumCells, 0);
+   for (int cell = layout.mStride; cell < layout.mNumCells - layout.mStride; ++cell)
+   {
+      for (int dir = 0; dir < 4; ++dir)
+      {
+         if (!layout.IsWall(cell + layout.mOffsets[dir]))
+         {
+            layout.mOpenNeighbors[cell] |= static_cast<std::uint8_t>(1u << dir);
+         }
+      }
+   }
+
+   // breadth-first search from the exit over the open cells
+   const int exitCell = layout.CellIndex(layout.mExit);
+   layout.mExitDistances.assign(layout.mNumCells, static_cast<std::uint16_t>(Unreachable));
+   layout.mExitDistances[exitCell] = 0;
+   std::vector<int> queue{ exitCell };
+   for (size_t i = 0; i < queue.size(); ++i)
+   {
+      const int cell = queue[i];
+      for (int dir = 0; dir < 4; ++dir)
+      {
+         const int next = cell + layout.mOffsets[dir];
+         if ((layout.mOpenNeighbors[cell] & (1u << dir)) && layout.mExitDistances[next] == Unreachable)
+         {
+            layout.mExitDistances[next] = static_cast<std::uint16_t>(layout.mExitDistances[cell] + 1);
+            queue.push_back(next);
+         }
+      }
+   }
+
+   std::uint64_t state = ZOBRIST_SEED;
+   layout.mZobristKeys.resize(layout.mNumCells);
+   for (auto& key : layout.mZobristKeys)
+   {
+      key = SplitMix64(state);
+   }
+   layout.mHeadKeys.resize(layout.mZobristKeys.size());
+   for (auto& key : layout.mHeadKeys)
+   {
+      key = SplitMix64(state);
+   }
+
+   return std::make_shared<const BoardLayout>(std::move(layout));
+}
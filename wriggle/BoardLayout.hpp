@@ -0,0 +1,129 @@
+
+#ifndef BOARDLAYOUT_HPP
+#define BOARDLAYOUT_HPP
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Bitset.hpp"
+#include "Location.hpp"
+
+// the parts of a puzzle that never change during a search; every board
+// state of a search shares one layout
+class BoardLayout
+{
+public:
+   // exit distance of cells that are walls or walled off from the exit
+   static constexpr int Unreachable = UINT16_MAX;
+
+   // cells, border included, that fit the 16-bit cell indices of snakes
+   static constexpr int MaxCells = UINT16_MAX;
+
+   BoardLayout() = default;
+
+   const Location& GetSize() const { return mSize; }
+   const Location& GetExit() const { return mExit; }
+   int GetStride() const { return mStride; }
+   int GetNumCells() const { return mNumCells; }
+
+   // cells are indexed row-major over the board plus a one-cell border,
+   // so every neighbor of an inside cell has a valid index
+   int CellIndex(const Location& aLocation) const
+   {
+      return (aLocation.GetY() + 1) * mStride + aLocation.GetX() + 1;
+   }
+
+   Location CellLocation(const int aCell) const
+   {
+      return { aCell % mStride - 1, aCell / mStride - 1 };
+   }
+
+   bool IsLocationInside(const Location& aLocation) const
+   {
+      int x = aLocation.GetX();
+      int y = aLocation.GetY();
+      return x >= 0 && x < mSize.GetX() && y >= 0 && y < mSize.GetY();
+   }
+
+   // the border is marked as wall
+   bool IsWall(const int aCell) const
+   {
+      return mWallBits.Test(aCell);
+   }
+
+   int Neighbor(const int aCell, const Direction aDirection) const
+   {
+      return aCell + mOffsets[static_cast<int>(aDirection)];
+   }
+
+   // bit d is set if the neighbor in direction d is not a wall
+   std::uint8_t OpenNeighbors(const int aCell) const
+   {
+      return mOpenNeighbors[aCell];
+   }
+
+   // random key for a snake occupying a cell; a board's hash is the xor of
+   // the keys of every occupied (snake, cell) pair
+   std::uint64_t ZobristKey(const int aSnakeIdx, const int aCell) const
+   {
+      return MixKey(mZobristKeys[aCell], aSnakeIdx);
+   }
+
+   // random key for a snake's head being on a cell, also folded into the
+   // hash so that a snake and its reverse hash differently
+   std::uint64_t HeadKey(const int aSnakeIdx, const int aCell) const
+   {
+      return MixKey(mHeadKeys[aCell], aSnakeIdx);
+   }
+
+   // number of steps from the cell to the exit around the walls, ignoring
+   // snakes
+   int ExitDistance(const int aCell) const
+   {
+      return mExitDistances[aCell];
+   }
+
+private:
+   // the key of a cell for one snake; the multiply makes the keys of one
+   // cell for different snakes independent under xor, so moving a snake
+   // onto the cells another left does not cancel out
+   static std::uint64_t MixKey(const std::uint64_t aCellKey, const int aSnakeIdx)
+   {
+      std::uint64_t key = aCellKey ^ (static_cast<std::uint64_t>(aSnakeIdx) * 0x9E3779B97F4A7C15ull);
+      key = (key ^ (key >> 32)) * 0xD6E8FEB86659FD93ull;
+      return key ^ (key >> 32);
+   }
+
+   Location mSize;
+   Location mExit;
+   int mStride = 0;
+   int mNumCells = 0;
+   Bitset mWallBits;
+   std::array<int, 4> mOffsets{};
+   std::vector<std::uint8_t> mOpenNeighbors;
+   std::vector<std::uint16_t> mExitDistances;
+
+   // one key per cell, shared by all snakes
+   std::vector<std::uint64_t> mZobristKeys;
+   std::vector<std::uint64_t> mHeadKeys;
+
+public:
+   class Builder
+   {
+   public:
+      Builder()
+         : mLayoutPtr{ std::make_unique<BoardLayout>() }
+      {}
+
+      void SetSize(const int aWidth, const int aHeight);
+      void AddWall(const Location& aLocation);
+      std::shared_ptr<const BoardLayout> Build();
+
+   private:
+      std::unique_ptr<BoardLayout> mLayoutPtr;
+   };
+};
+
+#endif
@@ -0,0 +1,107 @@
+
+#ifndef BUCKETQUEUE_HPP
+#define BUCKETQUEUE_HPP
+
+#include <cstddef>
+#include <vector>
+
+// open list for nodes with small non-negative integer keys, kept in buckets
+// by a primary key and, within it, by a secondary key that breaks ties; the
+// lowest keys come out first, and a bucket hands out its nodes last in,
+// first out. Keys provides static int Primary(const T*) and
+// Secondary(const T*). a node whose keys decreased is queued again rather
+// than moved, so keys may only ever decrease while a node is queued; the
+// entry left behind no longer matches the node's keys and is skipped
+template <typename T, typename Keys>
+class BucketQueue
+{
+public:
+   bool Empty() const { return mSize == 0; }
+   size_t Size() const { return mSize; }
+
+   // mHeapIdx only records whether the node is queued
+   static bool Contains(const T* aNodePtr) { return aNodePtr->mHeapIdx >= 0; }
+
+   void Push(T* aNodePtr)
+   {
+      aNodePtr->mHeapIdx = 0;
+      ++mSize;
+      Insert(aNodePtr);
+   }
+
+   T* Pop()
+   {
+      while (true)
+      {
+         while (mLevels[mMinPrimary].mCount == 0)
+         {
+            ++mMinPrimary;
+         }
+         Level& level = mLevels[mMinPrimary];
+         while (level.mBuckets[level.mMinSecondary].empty())
+         {
+            ++level.mMinSecondary;
+         }
+
+         std::vector<T*>& bucket = level.mBuckets[level.mMinSecondary];
+         T* nodePtr = bucket.back();
+         bucket.pop_back();
+         --level.mCount;
+         if (Contains(nodePtr) && Keys::Primary(nodePtr) == static_cast<int>(mMinPrimary)
+            && Keys::Secondary(nodePtr) == static_cast<int>(level.mMinSecondary))
+         {
+            nodePtr->mHeapIdx = -1;
+            --mSize;
+            return nodePtr;
+         }
+      }
+   }
+
+   // call after the node's keys have decreased
+   void DecreaseKey(T* aNodePtr)
+   {
+      Insert(aNodePtr);
+   }
+
+private:
+   // every entry of a level has a secondary key of at least mMinSecondary,
+   // and every level below mMinPrimary is empty
+   struct Level
+   {
+      std::vector<std::vector<T*>> mBuckets;
+      size_t mCount = 0;
+      size_t mMinSecondary = 0;
+   };
+
+   void Insert(T* aNodePtr)
+   {
+      const size_t primary = static_cast<size_t>(Keys::Primary(aNodePtr));
+      const size_t secondary = static_cast<size_t>(Keys::Secondary(aNodePtr));
+      if (primary >= mLevels.size())
+      {
+         mLevels.resize(primary + 1);
+      }
+
+      Level& level = mLevels[primary];
+      if (secondary >= level.mBuckets.size())
+      {
+         level.mBuckets.resize(secondary + 1);
+      }
+      level.mBuckets[secondary].push_back(aNodePtr);
+
+      if (level.mCount++ == 0 || secondary < level.mMinSecondary)
+      {
+         level.mMinSecondary = secondary;
+      }
+      if (primary < mMinPrimary)
+      {
+         mMinPrimary = primary;
+      }
+   }
+
+   std::vector<Level> mLevels;
+   size_t mMinPrimary = 0;
+   size_t mSize = 0;
+};
+
+#endif
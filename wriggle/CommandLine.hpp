@@ -0,0 +1,39 @@
+
+#ifndef COMMANDLINE_HPP
+#define COMMANDLINE_HPP
+
+#include <charconv>
+#include <string>
+#include <system_error>
+
+// option parsing shared by the command line tools
+
+// matches options of the form --name=value
+inline bool ParseOption(const std::string& aArg, const std::string& aName, std::string& aValue)
+{
+   const std::string prefix = "--" + aName + "=";
+   if (aArg.compare(0, prefix.size(), prefix) != 0)
+   {
+      return false;
+   }
+   aValue = aArg.substr(prefix.size());
+   return true;
+}
+
+// parses the whole of aValue as a number in [aMin, aMax] into aNumber;
+// returns false and leaves aNumber as it was for any other value
+template <typename T>
+bool ReadNumber(const std::string& aValue, const T aMin, const T aMax, T& aNumber)
+{
+   T number{};
+   const char* end = aValue.data() + aValue.size();
+   const auto result = std::from_chars(aValue.data(), end, number);
+   if (result.ec != std::errc{} || result.ptr != end || !(number >= aMin && number <= aMax))
+   {
+      return false;
+   }
+   aNumber = number;
+   return true;
+}
+
+#endif
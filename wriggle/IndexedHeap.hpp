@@ -0,0 +1,104 @@
+
+#ifndef INDEXEDHEAP_HPP
+#define INDEXEDHEAP_HPP
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// binary heap of node pointers that records each node's position in the
+// node's mHeapIdx, so a node whose key improved can be moved up in place;
+// Compare follows std::priority_queue: it returns true if the first node
+// should come out after the second
+template <typename T, typename Compare>
+class IndexedHeap
+{
+public:
+   bool Empty() const { return mHeap.empty(); }
+   size_t Size() const { return mHeap.size(); }
+
+   static bool Contains(const T* aNodePtr) { return aNodePtr->mHeapIdx >= 0; }
+
+   void Push(T* aNodePtr)
+   {
+      mHeap.push_back(aNodePtr);
+      aNodePtr->mHeapIdx = static_cast<int>(mHeap.size() - 1);
+      SiftUp(mHeap.size() - 1);
+   }
+
+   T* Top() const { return mHeap.front(); }
+
+   T* Pop()
+   {
+      T* topPtr = mHeap.front();
+      topPtr->mHeapIdx = -1;
+      T* lastPtr = mHeap.back();
+      mHeap.pop_back();
+      if (!mHeap.empty())
+      {
+         mHeap.front() = lastPtr;
+         lastPtr->mHeapIdx = 0;
+         SiftDown(0);
+      }
+      return topPtr;
+   }
+
+   // call after the node's key has improved
+   void DecreaseKey(T* aNodePtr)
+   {
+      SiftUp(static_cast<size_t>(aNodePtr->mHeapIdx));
+   }
+
+private:
+   void Place(const size_t aIdx, T* aNodePtr)
+   {
+      mHeap[aIdx] = aNodePtr;
+      aNodePtr->mHeapIdx = static_cast<int>(aIdx);
+   }
+
+   void SiftUp(size_t aIdx)
+   {
+      T* nodePtr = mHeap[aIdx];
+      while (aIdx > 0)
+      {
+         const size_t parentIdx = (aIdx - 1) / 2;
+         if (!mCompare(mHeap[parentIdx], nodePtr))
+         {
+            break;
+         }
+         Place(aIdx, mHeap[parentIdx]);
+         aIdx = parentIdx;
+      }
+      Place(aIdx, nodePtr);
+   }
+
+   void SiftDown(size_t aIdx)
+   {
+      T* nodePtr = mHeap[aIdx];
+      const size_t size = mHeap.size();
+      while (true)
+      {
+         size_t childIdx = 2 * aIdx + 1;
+         if (childIdx >= size)
+         {
+            break;
+         }
+         if (childIdx + 1 < size && mCompare(mHeap[childIdx], mHeap[childIdx + 1]))
+         {
+            ++childIdx;
+         }
+         if (!mCompare(nodePtr, mHeap[childIdx]))
+         {
+            break;
+         }
+         Place(aIdx, mHeap[childIdx]);
+         aIdx = childIdx;
+      }
+      Place(aIdx, nodePtr);
+   }
+
+   std::vector<T*> mHeap;
+   Compare mCompare;
+};
+
+#endif
@@ -62,7 +62,7 @@ Location Location::Nudge(const Direction aDir) const
 
 int Location::Taxicab() const
 {
-   return std::abs(mX + mY);
+   return std::abs(mX) + std::abs(mY);
 }
 
 size_t Location::Hash() const
@@ -3,6 +3,7 @@
 #define LOCATION_HPP
 
 #include <algorithm>
+#include <functional>
 
 enum class Direction
 {
@@ -0,0 +1,62 @@
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include "MappedFile.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define WRIGGLE_HAS_MMAP 1
+#endif
+
+MappedFile::MappedFile(const std::string& aPath)
+{
+#ifdef WRIGGLE_HAS_MMAP
+   const int fd = ::open(aPath.c_str(), O_RDONLY);
+   if (fd < 0)
+   {
+      throw std::runtime_error("cannot read " + aPath);
+   }
+
+   struct stat info;
+   if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+   {
+      void* data = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED)
+      {
+         mData = static_cast<const char*>(data);
+         mSize = static_cast<size_t>(info.st_size);
+         mMapped = true;
+      }
+   }
+   ::close(fd);
+   if (mMapped)
+   {
+      return;
+   }
+#endif
+
+   // empty files, pipes and systems without mmap
+   std::ifstream in{ aPath, std::ios::binary };
+   if (!in)
+   {
+      throw std::runtime_error("cannot read " + aPath);
+   }
+   mBuffer.assign(std::istreambuf_iterator<char>{ in }, std::istreambuf_iterator<char>{});
+   mData = mBuffer.data();
+   mSize = mBuffer.size();
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef WRIGGLE_HAS_MMAP
+   if (mMapped)
+   {
+      ::munmap(const_cast<char*>(mData), mSize);
+   }
+#endif
+}
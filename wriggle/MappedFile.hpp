@@ -0,0 +1,34 @@
+
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// a whole file mapped read-only into memory; where mapping is not
+// available the file is read into a buffer instead
+class MappedFile
+{
+public:
+   MappedFile() = delete;
+
+   // throws std::runtime_error if the file cannot be opened or read
+   explicit MappedFile(const std::string& aPath);
+
+   MappedFile(const MappedFile&) = delete;
+   MappedFile& operator=(const MappedFile&) = delete;
+
+   ~MappedFile();
+
+   const char* Data() const { return mData; }
+   size_t Size() const { return mSize; }
+
+private:
+   const char* mData = nullptr;
+   size_t mSize = 0;
+   bool mMapped = false;
+   std::vector<char> mBuffer;
+};
+
+#endif
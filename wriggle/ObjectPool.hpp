@@ -0,0 +1,80 @@
+
+#ifndef OBJECTPOOL_HPP
+#define OBJECTPOOL_HPP
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// constructs objects in fixed-size chunks carved out of a memory resource;
+// objects never move and are only destroyed together, by Clear or when the
+// pool goes away, so a whole search tree is torn down in one linear sweep
+template <typename T>
+class ObjectPool
+{
+public:
+   static constexpr size_t ChunkSize = 1024;
+
+   explicit ObjectPool(std::pmr::memory_resource* aResource)
+      : mResource{ aResource }
+   {}
+
+   ObjectPool(const ObjectPool&) = delete;
+   ObjectPool& operator=(const ObjectPool&) = delete;
+
+   ~ObjectPool()
+   {
+      Clear();
+   }
+
+   template <typename... Args>
+   T* New(Args&&... aArgs)
+   {
+      if (mUsed == ChunkSize || mChunks.empty())
+      {
+         mChunks.push_back(static_cast<T*>(mResource->allocate(ChunkSize * sizeof(T), alignof(T))));
+         mUsed = 0;
+      }
+      T* objPtr = new (mChunks.back() + mUsed) T(std::forward<Args>(aArgs)...);
+      ++mUsed;
+      ++mSize;
+      return objPtr;
+   }
+
+   size_t Size() const
+   {
+      return mSize;
+   }
+
+   // destroys every object; the chunks go back to the resource, which
+   // decides when to actually release them
+   void Clear()
+   {
+      for (size_t i = 0; i < mChunks.size(); ++i)
+      {
+         if constexpr (!std::is_trivially_destructible_v<T>)
+         {
+            const size_t count = i + 1 == mChunks.size() ? mUsed : ChunkSize;
+            for (size_t j = 0; j < count; ++j)
+            {
+               mChunks[i][j].~T();
+            }
+         }
+         mResource->deallocate(mChunks[i], ChunkSize * sizeof(T), alignof(T));
+      }
+      mChunks.clear();
+      mUsed = 0;
+      mSize = 0;
+   }
+
+private:
+   std::pmr::memory_resource* mResource;
+   std::vector<T*> mChunks;
+   size_t mUsed = 0;
+   size_t mSize = 0;
+};
+
+#endif
@@ -0,0 +1,504 @@
+#include "ParallelSolver.hpp"
+
+#include <algorithm>
+#include <thread>
+
+void ParallelBreadthFirstSearchSolver::Solve()
+{
+   const int threadCount = std::max(1, mThreadCount);
+   for (int i = 0; i < threadCount; ++i)
+   {
+      mWorkers.push_back(std::make_unique<Worker>(*mInitialPtr));
+   }
+
+   Worker& first = *mWorkers.front();
+   Worker::LayerBoards& rootLayer = first.mLayers[0];
+   SearchNode* rootPtr = first.mNodes.New(nullptr, Board::Move{},
+      rootLayer.mBoards.New(*mInitialPtr, Board::allocator_type{ &rootLayer.mArena }));
+   mSeen.Insert(*mInitialPtr);
+   mLayer.push_back(rootPtr);
+   if (mInitialPtr->IsSolved())
+   {
+      mSolutionPtr = rootPtr;
+   }
+
+   std::vector<std::thread> threads;
+   for (size_t i = 1; i < mWorkers.size(); ++i)
+   {
+      threads.emplace_back(&ParallelBreadthFirstSearchSolver::RunWorker, this, i);
+   }
+
+   while (!mLayer.empty() && !mSolutionPtr && !IsCancelled())
+   {
+      mStats.NoteFrontier(mLayer.size());
+
+      // the boards two layers back are no longer referenced by any
+      // queued node, so their arenas are reused for the next layer
+      const int nextParity = (mDepth + 1) & 1;
+      for (auto& workerPtr : mWorkers)
+      {
+         Worker::LayerBoards& layer = workerPtr->mLayers[nextParity];
+         layer.mBoards.Clear();
+         layer.mArena.release();
+      }
+
+      // narrow layers are not worth waking the other threads for
+      mNextIdx = 0;
+      const size_t useCount = std::min(mWorkers.size(), (mLayer.size() + ChunkSize - 1) / ChunkSize);
+      if (useCount > 1)
+      {
+         std::lock_guard<std::mutex> lock{ mLayerMutex };
+         mUseCount = useCount;
+         mBusy = useCount - 1;
+         mNextParity = nextParity;
+         ++mGeneration;
+         mLayerStarted.notify_all();
+      }
+      ExpandLayer(first, nextParity);
+      {
+         std::unique_lock<std::mutex> lock{ mLayerMutex };
+         mLayerDone.wait(lock, [this] { return mBusy == 0; });
+      }
+
+      // barrier passed, gather the next layer
+      mLayer.clear();
+      for (auto& workerPtr : mWorkers)
+      {
+         mLayer.insert(mLayer.end(), workerPtr->mNext.begin(), workerPtr->mNext.end());
+         workerPtr->mNext.clear();
+      }
+      ++mDepth;
+   }
+
+   {
+      std::lock_guard<std::mutex> lock{ mLayerMutex };
+      mStopping = true;
+      mLayerStarted.notify_all();
+   }
+   for (auto& thread : threads)
+   {
+      thread.join();
+   }
+
+   // the layer is the frontier, so the workers' peaks mean nothing
+   for (auto& workerPtr : mWorkers)
+   {
+      mStats.mExpanded += workerPtr->mStats.mExpanded;
+      mStats.mGenerated += workerPtr->mStats.mGenerated;
+      mStats.mDuplicates += workerPtr->mStats.mDuplicates;
+   }
+   mStats.mExploredSize = mSeen.Size();
+
+   if (mSolutionPtr)
+   {
+      mSolved = true;
+      TraceSolution(mSolutionPtr);
+   }
+}
+
+void ParallelBreadthFirstSearchSolver::RunWorker(const size_t aWorkerIdx)
+{
+   std::uint64_t generation = 0;
+   std::unique_lock<std::mutex> lock{ mLayerMutex };
+   while (true)
+   {
+      mLayerStarted.wait(lock, [this, &generation] { return mStopping || mGeneration != generation; });
+      if (mStopping)
+      {
+         return;
+      }
+      generation = mGeneration;
+      if (aWorkerIdx >= mUseCount)
+      {
+         continue;
+      }
+
+      const int nextParity = mNextParity;
+      lock.unlock();
+      ExpandLayer(*mWorkers[aWorkerIdx], nextParity);
+      lock.lock();
+      if (--mBusy == 0)
+      {
+         mLayerDone.notify_one();
+      }
+   }
+}
+
+void ParallelBreadthFirstSearchSolver::ExpandLayer(Worker& aWorker, const int aNextParity)
+{
+   Worker::LayerBoards& nextLayer = aWorker.mLayers[aNextParity];
+   const size_t layerSize = mLayer.size();
+
+   size_t begin;
+   while ((begin = mNextIdx.fetch_add(ChunkSize)) < layerSize)
+   {
+      // every node of this layer is as deep as the solution already found
+      if (mSolutionPtr.load(std::memory_order_relaxed) || IsCancelled())
+      {
+         return;
+      }
+
+      const size_t end = std::min(begin + ChunkSize, layerSize);
+      for (size_t i = begin; i < end; ++i)
+      {
+         SearchNode* currentPtr = mLayer[i];
+         const Board& board = *currentPtr->mBoardPtr;
+         ++aWorker.mStats.mExpanded;
+         for (const auto& move : board.LegalMoves())
+         {
+            ++aWorker.mStats.mGenerated;
+            aWorker.mScratch = board;
+            aWorker.mScratch.MakeMove(move);
+            if (!mSeen.Insert(aWorker.mScratch))
+            {
+               ++aWorker.mStats.mDuplicates;
+               continue;
+            }
+
+            Board* nextBoardPtr = nextLayer.mBoards.New(aWorker.mScratch, Board::allocator_type{ &nextLayer.mArena });
+            SearchNode* nextPtr = aWorker.mNodes.New(currentPtr, move, nextBoardPtr);
+            if (nextBoardPtr->IsSolved())
+            {
+               SearchNode* expected = nullptr;
+               mSolutionPtr.compare_exchange_strong(expected, nextPtr);
+               return;
+            }
+            aWorker.mNext.push_back(nextPtr);
+         }
+      }
+
+      // only the first worker checks; it runs every layer and takes chunks
+      // until none are left, so once it is out of work the others finish at
+      // most a chunk each before the layer barrier, and the checks are
+      // never more than a layer apart
+      mSharedExpanded.fetch_add(end - begin);
+      if (&aWorker == mWorkers.front().get() && CheckLimits(mSharedExpanded.load(), mDepth, layerSize))
+      {
+         return;
+      }
+   }
+}
+
+size_t ParallelBreadthFirstSearchSolver::MemoryBytes() const
+{
+   // every state keeps its node and table slot, and the boards of two
+   // layers are kept
+   const size_t stateBytes = mInitialPtr->GetStateBytes();
+   return mSeen.Size() * (sizeof(SearchNode) + 2 * sizeof(std::uint64_t) + stateBytes)
+      + 2 * mLayer.size() * (sizeof(Board) + stateBytes);
+}
+
+void HashDistributedAStarSolver::Solve()
+{
+   const size_t workerCount = static_cast<size_t>(std::max(1, mThreadCount));
+   for (size_t i = 0; i < workerCount; ++i)
+   {
+      mWorkers.push_back(std::make_unique<Worker>(*mInitialPtr, workerCount));
+   }
+
+   Worker& rootOwner = *mWorkers[OwnerOf(mInitialPtr->Hash())];
+   rootOwner.mScratch = *mInitialPtr;
+   Receive(rootOwner, Message{ nullptr, Board::Move{}.Pack(), 0 });
+   mStats.mInitialEstimate = rootOwner.mOpen.Top()->mHeuristicScore;
+
+   mActive = static_cast<int>(workerCount);
+   std::vector<std::thread> threads;
+   for (size_t i = 1; i < workerCount; ++i)
+   {
+      threads.emplace_back(&HashDistributedAStarSolver::Run, this, std::ref(*mWorkers[i]));
+   }
+   Run(*mWorkers.front());
+   for (auto& thread : threads)
+   {
+      thread.join();
+   }
+
+   for (auto& workerPtr : mWorkers)
+   {
+      workerPtr->mStats.mExploredSize = workerPtr->mStates.Size();
+      mStats.Merge(workerPtr->mStats);
+   }
+
+   // a cancelled search has not proven its incumbent
+   if (mBestPtr && !IsCancelled())
+   {
+      mSolved = true;
+      TraceSolution(mBestPtr);
+   }
+}
+
+void HashDistributedAStarSolver::Run(Worker& aWorker)
+{
+   // only the first worker checks the limits, also while it waits for
+   // mail, as the others may go on expanding meanwhile
+   const bool checksLimits = &aWorker == mWorkers.front().get();
+   int bound = 0;
+   int sinceFlush = 0;
+   while (!IsCancelled())
+   {
+      if (aWorker.mHasMail.load())
+      {
+         ReadInbox(aWorker);
+      }
+
+      if (!aWorker.mOpen.Empty())
+      {
+         aWorker.mStats.NoteFrontier(aWorker.mOpen.Size());
+         SearchNode* nodePtr = aWorker.mOpen.Pop();
+         bound = nodePtr->mDepth + nodePtr->mHeuristicScore;
+         if (checksLimits && CheckLimits(mSharedExpanded.load(), bound, aWorker.mOpen.Size()))
+         {
+            return;
+         }
+
+         Expand(aWorker, nodePtr);
+         if (++sinceFlush == FlushInterval)
+         {
+            for (size_t owner = 0; owner < mWorkers.size(); ++owner)
+            {
+               Post(aWorker, owner);
+            }
+            Report(aWorker);
+            sinceFlush = 0;
+         }
+         continue;
+      }
+
+      // out of work; wait for mail unless every other worker is idle too
+      // and nothing is in flight, in which case the search is over
+      for (size_t owner = 0; owner < mWorkers.size(); ++owner)
+      {
+         Post(aWorker, owner);
+      }
+      Report(aWorker);
+      mActive.fetch_sub(1);
+      while (!aWorker.mHasMail.load())
+      {
+         if (mActive.load() == 0 || IsCancelled() || (checksLimits && CheckLimits(mSharedExpanded.load(), bound, 0)))
+         {
+            return;
+         }
+         std::this_thread::yield();
+      }
+      mActive.fetch_add(1);
+   }
+}
+
+void HashDistributedAStarSolver::Expand(Worker& aWorker, SearchNode* aNodePtr)
+{
+   // the node stays closed, and only reopens if a shorter path arrives
+   if (aNodePtr->mDepth + aNodePtr->mLowerBound >= mBestCost.load())
+   {
+      return;
+   }
+
+   const Board& board = *aNodePtr->mBoardPtr;
+   if (board.IsSolved())
+   {
+      std::lock_guard<std::mutex> lock{ mBestMutex };
+      if (aNodePtr->mDepth < mBestCost.load())
+      {
+         mBestCost = aNodePtr->mDepth;
+         mBestPtr = aNodePtr;
+      }
+      return;
+   }
+
+   ++aWorker.mStats.mExpanded;
+   const int nextDepth = aNodePtr->mDepth + 1;
+   for (const auto& move : board.LegalMoves())
+   {
+      ++aWorker.mStats.mGenerated;
+      aWorker.mScratch = board;
+      aWorker.mScratch.MakeMove(move);
+      if (nextDepth + LowerBound(aWorker.mScratch) >= mBestCost.load())
+      {
+         continue;
+      }
+
+      const Message message{ aNodePtr, move.Pack(), nextDepth };
+      const size_t owner = OwnerOf(aWorker.mScratch.Hash());
+      if (&aWorker == mWorkers[owner].get())
+      {
+         Receive(aWorker, message);
+         continue;
+      }
+
+      std::vector<Message>& outbox = aWorker.mOutboxes[owner];
+      outbox.push_back(message);
+      if (outbox.size() >= BatchSize)
+      {
+         Post(aWorker, owner);
+      }
+   }
+}
+
+void HashDistributedAStarSolver::Receive(Worker& aWorker, const Message& aMessage)
+{
+   bool inserted;
+   const size_t slot = aWorker.mStates.FindOrInsert(aWorker.mScratch, inserted);
+   if (inserted)
+   {
+      Board* boardPtr = aWorker.mBoards.New(aWorker.mScratch, Board::allocator_type{ &aWorker.mArena });
+      SearchNode* nodePtr = aWorker.mNodes.New(aMessage.mParentPtr, Board::Move::Unpack(aMessage.mMove),
+         boardPtr, aMessage.mDepth, Estimate(aWorker.mScratch), LowerBound(aWorker.mScratch));
+      aWorker.mStates.SetValue(slot, nodePtr);
+      aWorker.mOpen.Push(nodePtr);
+      return;
+   }
+
+   // unlike the sequential search, a state may be expanded before its
+   // shortest path arrives from another worker, so closed nodes reopen
+   auto* seenPtr = static_cast<SearchNode*>(aWorker.mStates.GetValue(slot));
+   if (aMessage.mDepth >= seenPtr->mDepth)
+   {
+      ++aWorker.mStats.mDuplicates;
+   }
+   else
+   {
+      seenPtr->mParentPtr = aMessage.mParentPtr;
+      seenPtr->mDepth = aMessage.mDepth;
+      seenPtr->mParentMove = aMessage.mMove;
+      if (aWorker.mOpen.Contains(seenPtr))
+      {
+         aWorker.mOpen.DecreaseKey(seenPtr);
+      }
+      else
+      {
+         aWorker.mOpen.Push(seenPtr);
+      }
+   }
+}
+
+void HashDistributedAStarSolver::ReadInbox(Worker& aWorker)
+{
+   size_t batches;
+   {
+      std::lock_guard<std::mutex> lock{ aWorker.mInboxMutex };
+      aWorker.mReceived.swap(aWorker.mInbox);
+      batches = aWorker.mInboxBatches;
+      aWorker.mInboxBatches = 0;
+      aWorker.mHasMail = false;
+   }
+
+   for (const auto& message : aWorker.mReceived)
+   {
+      aWorker.mScratch = *message.mParentPtr->mBoardPtr;
+      aWorker.mScratch.MakeMove(Board::Move::Unpack(message.mMove));
+      Receive(aWorker, message);
+   }
+   aWorker.mReceived.clear();
+
+   // only now that the states are queued may the batches stop counting
+   mActive.fetch_sub(static_cast<int>(batches));
+}
+
+void HashDistributedAStarSolver::Post(Worker& aWorker, const size_t aOwner)
+{
+   std::vector<Message>& outbox = aWorker.mOutboxes[aOwner];
+   if (outbox.empty())
+   {
+      return;
+   }
+
+   Worker& owner = *mWorkers[aOwner];
+   mActive.fetch_add(1);
+   {
+      std::lock_guard<std::mutex> lock{ owner.mInboxMutex };
+      owner.mInbox.insert(owner.mInbox.end(), outbox.begin(), outbox.end());
+      ++owner.mInboxBatches;
+      owner.mHasMail = true;
+   }
+   outbox.clear();
+}
+
+void HashDistributedAStarSolver::Report(Worker& aWorker)
+{
+   mSharedExpanded.fetch_add(aWorker.mStats.mExpanded - aWorker.mReportedExpanded);
+   mSharedStored.fetch_add(aWorker.mStates.Size() - aWorker.mReportedStored);
+   aWorker.mReportedExpanded = aWorker.mStats.mExpanded;
+   aWorker.mReportedStored = aWorker.mStates.Size();
+}
+
+size_t HashDistributedAStarSolver::MemoryBytes() const
+{
+   // every state keeps its node, board, table slot and open list entry
+   const size_t stateBytes = mInitialPtr->GetStateBytes();
+   return mSharedStored.load() * (sizeof(SearchNode) + sizeof(Board) + 2 * stateBytes + 3 * sizeof(std::uint64_t));
+}
+
+void PortfolioSolver::Solve()
+{
+   std::vector<std::thread> threads;
+   for (auto& enginePtr : mEngines)
+   {
+      threads.emplace_back(&PortfolioSolver::Run, this, std::ref(*enginePtr));
+   }
+   for (auto& thread : threads)
+   {
+      thread.join();
+   }
+
+   if (mWinnerPtr)
+   {
+      mSolved = true;
+      mMoves = *mWinnerPtr->GetSolutionMoves();
+      mSolvedPtr = std::make_unique<Board>(*mWinnerPtr->GetSolutionBoard());
+      mStats = mWinnerPtr->GetStats();
+      return;
+   }
+
+   // without a winner, the first engine stopped by a limit gives the reason
+   for (auto& enginePtr : mEngines)
+   {
+      if (enginePtr->IsLimitReached())
+      {
+         mStopReason = enginePtr->GetStopReason();
+         break;
+      }
+   }
+}
+
+size_t PortfolioSolver::MemoryBytes() const
+{
+   size_t bytes = 0;
+   for (const auto& enginePtr : mEngines)
+   {
+      bytes += enginePtr->MemoryBytes();
+   }
+   return bytes;
+}
+
+void PortfolioSolver::Cancel()
+{
+   Solver::Cancel();
+   for (auto& enginePtr : mEngines)
+   {
+      enginePtr->Cancel();
+   }
+}
+
+bool PortfolioSolver::IsOptimal() const
+{
+   return mWinnerPtr && mWinnerPtr->IsOptimal();
+}
+
+void PortfolioSolver::Run(Solver& aEngine)
+{
+   aEngine.Exec();
+
+   std::lock_guard<std::mutex> lock{ mWinnerMutex };
+   if (mWinnerPtr || !aEngine.IsSolved())
+   {
+      return;
+   }
+
+   mWinnerPtr = &aEngine;
+   for (auto& enginePtr : mEngines)
+   {
+      if (enginePtr.get() != &aEngine)
+      {
+         enginePtr->Cancel();
+      }
+   }
+}
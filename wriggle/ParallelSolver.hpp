@@ -0,0 +1,286 @@
+
+#ifndef PARALLELSOLVER_HPP
+#define PARALLELSOLVER_HPP
+
+#include <array>
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+#include "Board.hpp"
+#include "IndexedHeap.hpp"
+#include "ObjectPool.hpp"
+#include "Solver.hpp"
+#include "StateTable.hpp"
+
+// breadth-first search that expands each depth layer on several threads;
+// the next layer is only assembled once every node of the current one has
+// been expanded, so the first solution found is still a shortest one
+class ParallelBreadthFirstSearchSolver : public Solver
+{
+public:
+   ParallelBreadthFirstSearchSolver() = delete;
+   ParallelBreadthFirstSearchSolver(const Board& aInitial)
+      : Solver{ aInitial }
+      , mSeen{ aInitial.GetStateBytes(), SeenShardBits }
+   {}
+
+   virtual ~ParallelBreadthFirstSearchSolver() = default;
+
+   void Solve() override;
+   const char* GetName() const override { return "pbfs"; }
+   bool IsOptimal() const override { return true; }
+
+   // estimated from the number of states, as the workers' pools cannot be
+   // read while they run
+   size_t MemoryBytes() const override;
+
+private:
+   static constexpr int SeenShardBits = 8;
+
+   // nodes handed out to a worker at a time
+   static constexpr size_t ChunkSize = 64;
+
+   // per-thread allocation and output; boards of alternating layers live
+   // in separate arenas, so the boards of a layer are released in one go
+   // once its children have all been generated
+   struct Worker
+   {
+      explicit Worker(const Board& aInitial)
+         : mScratch{ aInitial }
+      {}
+
+      struct LayerBoards
+      {
+         std::pmr::monotonic_buffer_resource mArena{ 1 << 16 };
+         ObjectPool<Board> mBoards{ &mArena };
+      };
+
+      std::pmr::monotonic_buffer_resource mNodeArena{ 1 << 16 };
+      ObjectPool<SearchNode> mNodes{ &mNodeArena };
+      std::array<LayerBoards, 2> mLayers;
+      Board mScratch;
+      std::vector<SearchNode*> mNext;
+      SearchStats mStats;
+   };
+
+   void ExpandLayer(Worker& aWorker, const int aNextParity);
+
+   // the loop of every worker but the first, which run for the whole
+   // search and expand each layer the first one starts
+   void RunWorker(const size_t aWorkerIdx);
+
+   std::vector<std::unique_ptr<Worker>> mWorkers;
+   std::vector<SearchNode*> mLayer;
+   int mDepth = 0;
+
+   // the layer barrier: the first worker bumps mGeneration to start the
+   // others on a layer and waits for mBusy to drop back to zero
+   std::mutex mLayerMutex;
+   std::condition_variable mLayerStarted;
+   std::condition_variable mLayerDone;
+   std::uint64_t mGeneration = 0;
+   size_t mUseCount = 0;
+   size_t mBusy = 0;
+   int mNextParity = 0;
+   bool mStopping = false;
+
+   std::atomic<size_t> mNextIdx{ 0 };
+   std::atomic<SearchNode*> mSolutionPtr{ nullptr };
+
+   // nodes expanded by all workers; the first worker checks the limits
+   std::atomic<size_t> mSharedExpanded{ 0 };
+
+   // every state generated so far, shared by all workers
+   ShardedStateTable mSeen;
+};
+
+// hash-distributed A*: every state has an owner thread picked by its hash,
+// and only the owner keeps it in its open list and state table; generated
+// states are batched up and mailed to their owners. workers expand in
+// AStarSolver order, but stop only once no open node can beat the best
+// solution by an admissible bound, so the solution returned is a shortest one
+class HashDistributedAStarSolver : public Solver
+{
+public:
+   HashDistributedAStarSolver() = delete;
+   HashDistributedAStarSolver(const Board& aInitial)
+      : Solver{ aInitial }
+   {}
+
+   virtual ~HashDistributedAStarSolver() = default;
+
+   void Solve() override;
+   const char* GetName() const override { return "hdastar"; }
+   bool IsOptimal() const override { return true; }
+
+   // estimated from the number of states, as the workers' pools cannot be
+   // read while they run
+   size_t MemoryBytes() const override;
+
+private:
+   // messages queued for one owner before they are posted
+   static constexpr size_t BatchSize = 64;
+
+   // expansions between posting whatever is queued, so owners do not
+   // fall behind on better states
+   static constexpr int FlushInterval = 16;
+
+   // a node's parent and depth are only ever changed by its owner, so
+   // messages carry the depth rather than reading it from the parent
+   class SearchNode : public Solver::SearchNode
+   {
+   public:
+      SearchNode(SearchNode* aParentPtr, const Board::Move& aMove, Board* aBoardPtr, const int aDepth,
+         const int aHeuristicScore, const int aLowerBound)
+         : Solver::SearchNode{ aParentPtr, aMove, aBoardPtr, aDepth }
+         , mHeuristicScore{ aHeuristicScore }
+         , mLowerBound{ aLowerBound }
+      {}
+
+      int mHeuristicScore;
+      int mLowerBound;
+      int mHeapIdx = -1;
+   };
+
+   // same order as AStarSolver
+   struct Compare
+   {
+      bool operator()(const SearchNode* aLhs, const SearchNode* aRhs) const
+      {
+         const int lhsScore = aLhs->mHeuristicScore + aLhs->mDepth;
+         const int rhsScore = aRhs->mHeuristicScore + aRhs->mDepth;
+         return lhsScore > rhsScore
+            || (lhsScore == rhsScore && aLhs->mHeuristicScore > aRhs->mHeuristicScore);
+      }
+   };
+
+   // the parent's board never changes once the parent exists, so the owner
+   // rebuilds the state from it
+   struct Message
+   {
+      SearchNode* mParentPtr;
+      std::uint16_t mMove;
+      int mDepth;
+   };
+
+   struct Worker
+   {
+      Worker(const Board& aInitial, const size_t aWorkerCount)
+         : mStates{ aInitial.GetStateBytes() }
+         , mScratch{ aInitial }
+         , mOutboxes(aWorkerCount)
+      {}
+
+      std::pmr::monotonic_buffer_resource mArena{ 1 << 16 };
+      ObjectPool<Board> mBoards{ &mArena };
+      ObjectPool<SearchNode> mNodes{ &mArena };
+
+      // maps every state owned by this worker to its node
+      StateTable mStates;
+      IndexedHeap<SearchNode, Compare> mOpen;
+      Board mScratch;
+
+      std::vector<std::vector<Message>> mOutboxes;
+      std::vector<Message> mReceived;
+      SearchStats mStats;
+
+      // counts already added to the shared ones
+      size_t mReportedExpanded = 0;
+      size_t mReportedStored = 0;
+
+      // written by other workers
+      std::mutex mInboxMutex;
+      std::vector<Message> mInbox;
+      size_t mInboxBatches = 0;
+      std::atomic<bool> mHasMail{ false };
+   };
+
+   // same as AStarSolver::Estimate
+   int Estimate(const Board& aBoard) const
+   {
+      if (mPatternDatabasePtr)
+      {
+         return LowerBound(aBoard);
+      }
+      return mHeuristicKind == HeuristicKind::Taxicab ? AStarSolver::Heuristic(aBoard) : DistanceFieldHeuristic(aBoard);
+   }
+
+   size_t OwnerOf(const std::uint64_t aHash) const
+   {
+      return static_cast<size_t>((aHash >> 32) % mWorkers.size());
+   }
+
+   void Run(Worker& aWorker);
+   void Expand(Worker& aWorker, SearchNode* aNodePtr);
+
+   // adds the state in aWorker.mScratch, reached through aMessage
+   void Receive(Worker& aWorker, const Message& aMessage);
+   void ReadInbox(Worker& aWorker);
+   void Post(Worker& aWorker, const size_t aOwner);
+
+   // adds what aWorker did since its last report to the shared counts
+   void Report(Worker& aWorker);
+
+   std::vector<std::unique_ptr<Worker>> mWorkers;
+
+   // workers not waiting for mail plus batches posted but not yet
+   // processed; the search is over once this drops to zero
+   std::atomic<int> mActive{ 0 };
+
+   std::mutex mBestMutex;
+   std::atomic<int> mBestCost{ INT_MAX };
+   SearchNode* mBestPtr = nullptr;
+
+   // nodes expanded and states stored by all workers, as of their last
+   // reports; the first worker checks the limits
+   std::atomic<size_t> mSharedExpanded{ 0 };
+   std::atomic<size_t> mSharedStored{ 0 };
+};
+
+// runs several solvers on the same board at once, each on its own thread;
+// the first to find a solution wins and the others are cancelled
+class PortfolioSolver : public Solver
+{
+public:
+   PortfolioSolver() = delete;
+   PortfolioSolver(const Board& aInitial, std::vector<std::unique_ptr<Solver>> aEngines)
+      : Solver{ aInitial }
+      , mEngines{ std::move(aEngines) }
+   {}
+
+   virtual ~PortfolioSolver() = default;
+
+   void Solve() override;
+   const char* GetName() const override { return "portfolio"; }
+
+   // also cancels every engine
+   void Cancel() override;
+
+   // that of the winner
+   bool IsOptimal() const override;
+
+   size_t MemoryBytes() const override;
+
+   // the engine whose solution was taken, or nullptr if none found one;
+   // the portfolio reports its statistics
+   const Solver* GetWinner() const
+   {
+      return mWinnerPtr;
+   }
+
+private:
+   void Run(Solver& aEngine);
+
+   std::vector<std::unique_ptr<Solver>> mEngines;
+   std::mutex mWinnerMutex;
+   Solver* mWinnerPtr = nullptr;
+};
+
+#endif
@@ -0,0 +1,260 @@
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "PatternDatabase.hpp"
+
+namespace
+{
+const char FILE_MAGIC[4] = { 'W', 'P', 'D', 'B' };
+const std::uint32_t FILE_VERSION = 1;
+
+// turns between consecutive links: straight, right or left; a snake can
+// never turn back onto itself
+int TurnCode(const Direction aPrev, const Direction aNext)
+{
+   const int turn = (static_cast<int>(aNext) - static_cast<int>(aPrev)) & 3;
+   return turn == 3 ? 2 : turn;
+}
+
+Direction ApplyTurn(const Direction aPrev, const int aCode)
+{
+   const int turn = aCode == 2 ? 3 : aCode;
+   return static_cast<Direction>((static_cast<int>(aPrev) + turn) & 3);
+}
+
+template <typename GetLink>
+size_t EncodeConfiguration(const int aHead, const int aLength, GetLink aGetLink)
+{
+   size_t idx = static_cast<size_t>(aHead);
+   if (aLength < 2)
+   {
+      return idx;
+   }
+
+   Direction prev = aGetLink(0);
+   idx = idx * 4 + static_cast<size_t>(prev);
+   for (int i = 1; i < aLength - 1; ++i)
+   {
+      const Direction next = aGetLink(i);
+      idx = idx * 3 + static_cast<size_t>(TurnCode(prev, next));
+      prev = next;
+   }
+   return idx;
+}
+
+Direction Opposite(const Direction aDirection)
+{
+   return static_cast<Direction>((static_cast<int>(aDirection) + 2) & 3);
+}
+}
+
+bool PatternDatabase::Save(const std::string& aPath) const
+{
+   std::ofstream out{ aPath, std::ios::binary };
+   const std::uint64_t entries = mDistances.size();
+   out.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+   out.write(reinterpret_cast<const char*>(&FILE_VERSION), sizeof(FILE_VERSION));
+   out.write(reinterpret_cast<const char*>(&mFingerprint), sizeof(mFingerprint));
+   out.write(reinterpret_cast<const char*>(&entries), sizeof(entries));
+   out.write(reinterpret_cast<const char*>(mDistances.data()), static_cast<std::streamsize>(mDistances.size()));
+   return static_cast<bool>(out);
+}
+
+size_t PatternDatabase::Index(const Snake& aSnake) const
+{
+   return EncodeConfiguration(aSnake.GetPartCell(Snake::SnakePart::Head), mLength,
+      [&aSnake](const int aLink) { return aSnake.GetLink(aLink); });
+}
+
+PatternDatabase::Builder::Builder(const BoardLayout& aLayout, const int aSnakeLength)
+   : mLayout{ aLayout }
+   , mDatabasePtr{ new PatternDatabase{} }
+{
+   PatternDatabase& database = *mDatabasePtr;
+   database.mLength = aSnakeLength;
+
+   // entries past MaxEntries are not counted, the table is not built then
+   mEntries = static_cast<size_t>(aLayout.GetNumCells());
+   for (int i = 0; i < aSnakeLength - 1 && mEntries <= MaxEntries; ++i)
+   {
+      mEntries *= i == 0 ? 4 : 3;
+   }
+
+   // FNV-1a over everything the table depends on
+   std::uint64_t fingerprint = 0xCBF29CE484222325ull;
+   auto Mix = [&fingerprint](const std::uint64_t aValue)
+   {
+      fingerprint = (fingerprint ^ aValue) * 0x100000001B3ull;
+   };
+   Mix(static_cast<std::uint64_t>(aLayout.GetStride()));
+   Mix(static_cast<std::uint64_t>(aLayout.GetNumCells()));
+   Mix(static_cast<std::uint64_t>(aLayout.CellIndex(aLayout.GetExit())));
+   Mix(static_cast<std::uint64_t>(aSnakeLength));
+   for (int cell = 0; cell < aLayout.GetNumCells(); ++cell)
+   {
+      Mix(aLayout.IsWall(cell) ? 1 : 0);
+   }
+   database.mFingerprint = fingerprint;
+}
+
+bool PatternDatabase::Builder::FromFile(const std::string& aPath)
+{
+   std::ifstream in{ aPath, std::ios::binary };
+   char magic[sizeof(FILE_MAGIC)];
+   std::uint32_t version = 0;
+   std::uint64_t fingerprint = 0;
+   std::uint64_t entries = 0;
+   in.read(magic, sizeof(magic));
+   in.read(reinterpret_cast<char*>(&version), sizeof(version));
+   in.read(reinterpret_cast<char*>(&fingerprint), sizeof(fingerprint));
+   in.read(reinterpret_cast<char*>(&entries), sizeof(entries));
+   if (!in
+      || std::memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0
+      || version != FILE_VERSION
+      || fingerprint != mDatabasePtr->mFingerprint
+      || entries != mEntries)
+   {
+      return false;
+   }
+
+   std::vector<std::uint8_t>& distances = mDatabasePtr->mDistances;
+   distances.resize(mEntries);
+   in.read(reinterpret_cast<char*>(distances.data()), static_cast<std::streamsize>(mEntries));
+   if (!in)
+   {
+      distances.clear();
+      return false;
+   }
+   mLoaded = true;
+   return true;
+}
+
+std::shared_ptr<const PatternDatabase> PatternDatabase::Builder::Build()
+{
+   if (mLoaded)
+   {
+      return std::shared_ptr<const PatternDatabase>{ mDatabasePtr.release() };
+   }
+   if (mEntries > MaxEntries)
+   {
+      return nullptr;
+   }
+
+   const int length = mDatabasePtr->mLength;
+   const int exitCell = mLayout.CellIndex(mLayout.GetExit());
+   std::vector<std::uint8_t>& distances = mDatabasePtr->mDistances;
+   distances.assign(mEntries, Unreachable);
+
+   // the solved configurations are every valid one that covers the exit
+   std::vector<int> cells(static_cast<size_t>(length));
+   std::vector<Direction> links(static_cast<size_t>(std::max(length - 1, 0)));
+   std::vector<int> codes(static_cast<size_t>(std::max(length - 2, 0)));
+   std::vector<std::uint32_t> layer;
+   for (size_t idx = 0; idx < mEntries; ++idx)
+   {
+      if (Decode(idx, cells, links, codes) && std::find(cells.begin(), cells.end(), exitCell) != cells.end())
+      {
+         distances[idx] = 0;
+         layer.push_back(static_cast<std::uint32_t>(idx));
+      }
+   }
+
+   // a move is undone by moving the other end back, so a breadth-first
+   // search forward from the goals finds every distance to them
+   std::vector<std::uint32_t> nextLayer;
+   std::vector<Direction> nextLinks(links.size());
+   for (int depth = 1; !layer.empty(); ++depth)
+   {
+      const std::uint8_t distance = static_cast<std::uint8_t>(std::min(depth, Unreachable - 1));
+      for (const std::uint32_t idx : layer)
+      {
+         Decode(idx, cells, links, codes);
+         for (const auto part : { Snake::SnakePart::Head, Snake::SnakePart::Tail })
+         {
+            const int endCell = part == Snake::SnakePart::Head ? cells.front() : cells.back();
+            for (int dir = 0; dir < 4; ++dir)
+            {
+               const Direction direction = static_cast<Direction>(dir);
+               const int nextCell = mLayout.Neighbor(endCell, direction);
+               if (mLayout.IsWall(nextCell) || std::find(cells.begin(), cells.end(), nextCell) != cells.end())
+               {
+                  continue;
+               }
+
+               int nextHead;
+               if (links.empty())
+               {
+                  nextHead = nextCell;
+               }
+               else if (part == Snake::SnakePart::Head)
+               {
+                  nextHead = nextCell;
+                  nextLinks[0] = Opposite(direction);
+                  std::copy(links.begin(), links.end() - 1, nextLinks.begin() + 1);
+               }
+               else
+               {
+                  nextHead = cells[1];
+                  std::copy(links.begin() + 1, links.end(), nextLinks.begin());
+                  nextLinks.back() = direction;
+               }
+
+               const size_t nextIdx = Encode(nextHead, nextLinks);
+               if (distances[nextIdx] == Unreachable)
+               {
+                  distances[nextIdx] = distance;
+                  nextLayer.push_back(static_cast<std::uint32_t>(nextIdx));
+               }
+            }
+         }
+      }
+      layer.swap(nextLayer);
+      nextLayer.clear();
+   }
+
+   return std::shared_ptr<const PatternDatabase>{ mDatabasePtr.release() };
+}
+
+bool PatternDatabase::Builder::Decode(size_t aIdx, std::vector<int>& aCells, std::vector<Direction>& aLinks,
+   std::vector<int>& aCodes) const
+{
+   const int length = static_cast<int>(aCells.size());
+   if (length >= 2)
+   {
+      for (int i = length - 3; i >= 0; --i)
+      {
+         aCodes[static_cast<size_t>(i)] = static_cast<int>(aIdx % 3);
+         aIdx /= 3;
+      }
+      aLinks[0] = static_cast<Direction>(aIdx % 4);
+      aIdx /= 4;
+      for (int i = 1; i < length - 1; ++i)
+      {
+         aLinks[static_cast<size_t>(i)] = ApplyTurn(aLinks[static_cast<size_t>(i - 1)], aCodes[static_cast<size_t>(i - 1)]);
+      }
+   }
+
+   aCells[0] = static_cast<int>(aIdx);
+   if (mLayout.IsWall(aCells[0]))
+   {
+      return false;
+   }
+   for (int i = 1; i < length; ++i)
+   {
+      const int cell = mLayout.Neighbor(aCells[static_cast<size_t>(i - 1)], aLinks[static_cast<size_t>(i - 1)]);
+      if (mLayout.IsWall(cell) || std::find(aCells.begin(), aCells.begin() + i, cell) != aCells.begin() + i)
+      {
+         return false;
+      }
+      aCells[static_cast<size_t>(i)] = cell;
+   }
+   return true;
+}
+
+size_t PatternDatabase::Builder::Encode(const int aHead, const std::vector<Direction>& aLinks) const
+{
+   return EncodeConfiguration(aHead, mDatabasePtr->mLength,
+      [&aLinks](const int aLink) { return aLinks[static_cast<size_t>(aLink)]; });
+}
@@ -0,0 +1,77 @@
+
+#ifndef PATTERNDATABASE_HPP
+#define PATTERNDATABASE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BoardLayout.hpp"
+#include "Snake.hpp"
+
+// exact number of moves the 0-snake needs to reach the exit when it is
+// alone among the walls, for every configuration it can take; the other
+// snakes only ever get in the way, so this is an admissible heuristic.
+// configurations are indexed by head cell, first link and then the turn
+// taken at every further link, as a snake can never fold back on itself
+class PatternDatabase
+{
+public:
+   // configurations that are invalid or cannot reach the exit at all
+   static constexpr std::uint8_t Unreachable = 255;
+
+   // largest table the builder will make, one byte per entry
+   static constexpr size_t MaxEntries = size_t{ 1 } << 28;
+
+   int Distance(const Snake& aSnake) const
+   {
+      return mDistances[Index(aSnake)];
+   }
+
+   size_t Size() const { return mDistances.size(); }
+   size_t MemoryBytes() const { return mDistances.capacity(); }
+
+   // returns false if the file could not be written
+   bool Save(const std::string& aPath) const;
+
+private:
+   PatternDatabase() = default;
+
+   size_t Index(const Snake& aSnake) const;
+
+   int mLength = 0;
+   std::uint64_t mFingerprint = 0;
+   std::vector<std::uint8_t> mDistances;
+
+public:
+   class Builder
+   {
+   public:
+      Builder() = delete;
+      Builder(const BoardLayout& aLayout, const int aSnakeLength);
+
+      // takes the table from a file saved for the same layout and snake
+      // length; returns false if there is no such file
+      bool FromFile(const std::string& aPath);
+
+      // builds the table unless it was loaded; returns nullptr if it would
+      // have more than MaxEntries entries
+      std::shared_ptr<const PatternDatabase> Build();
+
+   private:
+      // fills in the cells and links of the configuration at aIdx; returns
+      // false if it crosses a wall or itself. aCodes is scratch space for
+      // the turns, sized by the caller to one less than aLinks
+      bool Decode(size_t aIdx, std::vector<int>& aCells, std::vector<Direction>& aLinks, std::vector<int>& aCodes) const;
+      size_t Encode(const int aHead, const std::vector<Direction>& aLinks) const;
+
+      const BoardLayout& mLayout;
+      std::unique_ptr<PatternDatabase> mDatabasePtr;
+      size_t mEntries = 0;
+      bool mLoaded = false;
+   };
+};
+
+#endif
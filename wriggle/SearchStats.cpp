@@ -0,0 +1,82 @@
+
+#include "SearchStats.hpp"
+
+void SearchStats::Merge(const SearchStats& aOther)
+{
+   mExpanded += aOther.mExpanded;
+   mGenerated += aOther.mGenerated;
+   mDuplicates += aOther.mDuplicates;
+   mPeakFrontier += aOther.mPeakFrontier;
+   mExploredSize += aOther.mExploredSize;
+}
+
+double SearchStats::EffectiveBranchingFactor(const int aSolutionLength) const
+{
+   if (aSolutionLength <= 0 || mGenerated == 0)
+   {
+      return 0.0;
+   }
+
+   // nodes below the root of a uniform tree of branching factor b and
+   // depth d: b + b^2 + ... + b^d, which grows with b, so b is bisected
+   const double target = static_cast<double>(mGenerated);
+   auto TreeSize = [aSolutionLength](const double aFactor)
+   {
+      double size = 0.0;
+      double level = 1.0;
+      for (int depth = 0; depth < aSolutionLength && size <= 1e300; ++depth)
+      {
+         level *= aFactor;
+         size += level;
+      }
+      return size;
+   };
+
+   double low = 0.0;
+   double high = std::max(1.0, target);
+   for (int step = 0; step < 100 && high - low > 1e-6; ++step)
+   {
+      const double mid = (low + high) / 2.0;
+      if (TreeSize(mid) < target)
+      {
+         low = mid;
+      }
+      else
+      {
+         high = mid;
+      }
+   }
+   return (low + high) / 2.0;
+}
+
+double SearchStats::HeuristicAccuracy(const int aSolutionLength) const
+{
+   if (mInitialEstimate < 0 || aSolutionLength <= 0)
+   {
+      return 0.0;
+   }
+   return static_cast<double>(mInitialEstimate) / aSolutionLength;
+}
+
+void SearchStats::PrintToStream(std::ostream& aOut, const int aSolutionLength) const
+{
+   aOut << "expanded " << mExpanded << std::endl
+      << "generated " << mGenerated << std::endl
+      << "duplicates " << mDuplicates << std::endl
+      << "peak frontier " << mPeakFrontier << std::endl
+      << "explored " << mExploredSize << std::endl
+      << "branching factor " << EffectiveBranchingFactor(aSolutionLength) << std::endl
+      << "heuristic accuracy " << HeuristicAccuracy(aSolutionLength) << std::endl;
+}
+
+void SearchStats::PrintJson(std::ostream& aOut, const int aSolutionLength) const
+{
+   aOut << "{\"expanded\":" << mExpanded
+      << ",\"generated\":" << mGenerated
+      << ",\"duplicates\":" << mDuplicates
+      << ",\"peak_frontier\":" << mPeakFrontier
+      << ",\"explored\":" << mExploredSize
+      << ",\"initial_estimate\":" << mInitialEstimate
+      << ",\"branching_factor\":" << EffectiveBranchingFactor(aSolutionLength)
+      << ",\"heuristic_accuracy\":" << HeuristicAccuracy(aSolutionLength) << '}';
+}
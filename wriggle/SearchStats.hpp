@@ -0,0 +1,64 @@
+
+#ifndef SEARCHSTATS_HPP
+#define SEARCHSTATS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+
+// counters a solver keeps while it searches; they are plain fields bumped
+// in the expand loops, so keeping them costs next to nothing
+struct SearchStats
+{
+   // nodes whose children were generated
+   size_t mExpanded = 0;
+
+   // children generated, duplicates included
+   size_t mGenerated = 0;
+
+   // children dropped because their state had been generated before
+   size_t mDuplicates = 0;
+
+   // most nodes waiting to be expanded at any one time
+   size_t mPeakFrontier = 0;
+
+   // states held in the solver's state table at the end, or at its
+   // fullest for solvers that clear it between iterations
+   size_t mExploredSize = 0;
+
+   // the solver's estimate of the moves needed from the initial board, or
+   // -1 for solvers that search without one
+   int mInitialEstimate = -1;
+
+   void NoteFrontier(const size_t aSize)
+   {
+      mPeakFrontier = std::max(mPeakFrontier, aSize);
+   }
+
+   void NoteExplored(const size_t aSize)
+   {
+      mExploredSize = std::max(mExploredSize, aSize);
+   }
+
+   // adds the counters of a part of the search done elsewhere, such as on
+   // another thread; peaks are added too, as the parts ran side by side
+   void Merge(const SearchStats& aOther);
+
+   // the branching factor b of a uniform tree as deep as the solution that
+   // has as many nodes below the root as were generated; 0 without a
+   // solution
+   double EffectiveBranchingFactor(const int aSolutionLength) const;
+
+   // the initial estimate as a fraction of the solution length, 1 for a
+   // perfect estimate; 0 without an estimate or a solution. for solvers
+   // that do not find shortest solutions this is only a lower figure
+   double HeuristicAccuracy(const int aSolutionLength) const;
+
+   // the counters and the figures derived from them, one per line
+   void PrintToStream(std::ostream& aOut, const int aSolutionLength) const;
+
+   // the same as one JSON object
+   void PrintJson(std::ostream& aOut, const int aSolutionLength) const;
+};
+
+#endif
@@ -1,78 +1,171 @@
 
+#include <cstring>
+#include <stdexcept>
+
 #include "Snake.hpp"
 
+namespace
+{
+constexpr Direction Opposite(const Direction aDirection)
+{
+   return static_cast<Direction>((static_cast<int>(aDirection) + 2) & 3);
+}
+}
+
+Snake::const_iterator& Snake::const_iterator::operator++()
+{
+   if (mSegment + 1 < mSnakePtr->mLength)
+   {
+      mCell += CellOffset(mSnakePtr->GetLink(mSegment), mSnakePtr->mStride);
+   }
+   ++mSegment;
+   return *this;
+}
+
+Snake::const_iterator Snake::const_iterator::operator++(int)
+{
+   const_iterator old = *this;
+   ++(*this);
+   return old;
+}
+
 bool Snake::OccupiesLocation(const Location& aLocation) const
 {
-   for (const auto& loc : mBody)
+   const int cell = (aLocation.GetY() + 1) * mStride + aLocation.GetX() + 1;
+   if (aLocation.GetX() < -1 || aLocation.GetX() + 1 >= mStride || cell < 0)
+   {
+      return false;
+   }
+
+   int segmentCell = mHead;
+   for (int link = 0; link < mLength - 1; ++link)
    {
-      if (loc == aLocation)
+      if (segmentCell == cell)
       {
          return true;
       }
+      segmentCell += CellOffset(GetLink(link), mStride);
    }
-   return false;
+   return segmentCell == cell;
 }
 
-const Location& Snake::GetPartLocation(const SnakePart aPart) const
+Location Snake::GetPartLocation(const SnakePart aPart) const
 {
+   return CellLocation(GetPartCell(aPart));
+}
+
+int Snake::MakeMove(const Snake::SnakePart aPart, const Direction aDirection)
+{
+   const int lastLink = mLength - 2;
+   int vacated;
    if (aPart == SnakePart::Head)
    {
-      return mBody.front();
+      vacated = mTail;
+      mTail = static_cast<std::uint16_t>(mTail - CellOffset(GetLink(lastLink), mStride));
+      mHead = static_cast<std::uint16_t>(mHead + CellOffset(aDirection, mStride));
+
+      // push the new link onto the front and drop the last one
+      mChain[1] = (mChain[1] << 2) | (mChain[0] >> 62);
+      mChain[0] = (mChain[0] << 2) | static_cast<std::uint64_t>(Opposite(aDirection));
+      if (lastLink + 1 < 64)
+      {
+         mChain[(lastLink + 1) >> 5] &= ~(std::uint64_t{ 3 } << (((lastLink + 1) & 31) * 2));
+      }
    }
    else // if aPart == SnakePart::Tail
    {
-      return mBody.back();
+      vacated = mHead;
+      mHead = static_cast<std::uint16_t>(mHead + CellOffset(GetLink(0), mStride));
+      mTail = static_cast<std::uint16_t>(mTail + CellOffset(aDirection, mStride));
+
+      // pop the front link and append the new one
+      mChain[0] = (mChain[0] >> 2) | (mChain[1] << 62);
+      mChain[1] >>= 2;
+      SetLink(lastLink, aDirection);
    }
+   return vacated;
 }
 
-void Snake::MakeMove(const Snake::SnakePart aPart, const Direction aDirection)
+int Snake::UnmakeMove(const Snake::SnakePart aPart, const int aVacated)
 {
-   const Location& partMoving = GetPartLocation(aPart);
-   Location newPart = partMoving.Nudge(aDirection);
-   if (aPart == SnakePart::Head)
+   const SnakePart otherPart = aPart == SnakePart::Head ? SnakePart::Tail : SnakePart::Head;
+   const int offset = aVacated - GetPartCell(otherPart);
+
+   Direction back = Direction::Left;
+   if (offset == -mStride)
    {
-      mBody.push_front(newPart);
-      mBody.pop_back();
+      back = Direction::Up;
    }
-   else // if aPart == SnakePart::Tail
+   else if (offset == 1)
    {
-      mBody.push_back(newPart);
-      mBody.pop_front();
+      back = Direction::Right;
    }
+   else if (offset == mStride)
+   {
+      back = Direction::Down;
+   }
+
+   // moving one end retracts the other along the body, which restores
+   // the links exactly as they were before the move
+   return MakeMove(otherPart, back);
 }
 
-size_t Snake::Hash() const
+void Snake::SetLink(const int aLink, const Direction aDirection)
+{
+   const int shift = (aLink & 31) * 2;
+   std::uint64_t& word = mChain[aLink >> 5];
+   word = (word & ~(std::uint64_t{ 3 } << shift)) | (static_cast<std::uint64_t>(aDirection) << shift);
+}
+
+bool Snake::IsChainTrimmed() const
 {
-   size_t hash = 0;
-   for (const auto& segment : mBody)
+   for (int link = mLength > 0 ? mLength - 1 : 0; link < MaxLength - 1; ++link)
    {
-      hash = segment.Hash() ^ (hash << 6);
+      if ((mChain[link >> 5] >> ((link & 31) * 2)) & 3u)
+      {
+         return false;
+      }
    }
-   return std::hash<size_t>{}(hash);
+   return true;
+}
+
+size_t Snake::Hash() const
+{
+   const std::uint64_t mix = 0x9E3779B97F4A7C15ull;
+   std::uint64_t hash = (std::uint64_t{ mHead } << 16) | mTail;
+   hash = (hash * mix) ^ mChain[0];
+   hash = (hash * mix) ^ mChain[1];
+   return std::hash<std::uint64_t>{}(hash * mix);
 }
 
 bool Snake::operator==(const Snake& aRhs) const
 {
-   return mBody == aRhs.mBody;
+   return std::memcmp(this, &aRhs, sizeof(Snake)) == 0;
 }
 
 void Snake::Builder::SetHead(const Location& aLocation)
 {
-   if (!mSnakePtr->mBody.empty())
-   {
-      mSnakePtr->mBody.clear();
-   }
-   mSnakePtr->mBody.emplace_back(aLocation);
+   const int stride = mSnakePtr->mStride;
+   mSnakePtr->mChain = {};
+   mSnakePtr->mHead = static_cast<std::uint16_t>((aLocation.GetY() + 1) * stride + aLocation.GetX() + 1);
+   mSnakePtr->mTail = mSnakePtr->mHead;
+   mSnakePtr->mLength = 1;
 }
 
 void Snake::Builder::AddSegment(const Direction aDirection)
 {
-   mSnakePtr->mBody.emplace_back(mSnakePtr->mBody.back().Nudge(aDirection));
+   if (mSnakePtr->mLength >= MaxLength)
+   {
+      throw std::length_error("snake is longer than Snake::MaxLength");
+   }
+   mSnakePtr->SetLink(mSnakePtr->mLength - 1, aDirection);
+   mSnakePtr->mTail = static_cast<std::uint16_t>(mSnakePtr->mTail + CellOffset(aDirection, mSnakePtr->mStride));
+   ++mSnakePtr->mLength;
 }
 
 void Snake::Builder::SetIndex(const int aIdx)
 {
-   mSnakePtr->mIdx = aIdx;
+   mSnakePtr->mIdx = static_cast<std::uint8_t>(aIdx);
 }
 
 Snake Snake::Builder::Build()
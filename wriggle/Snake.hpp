@@ -2,47 +2,131 @@
 #ifndef SNAKE_HPP
 #define SNAKE_HPP
 
-#include <deque>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <memory>
+#include <type_traits>
 
 #include "Location.hpp"
 
+// a snake is stored as its head and tail cell indices plus the chain of
+// directions leading from the head to the tail, packed two bits per link;
+// cells are indexed row-major over the board plus a one-cell border
 class Snake
 {
 public:
-   using const_iterator = std::deque<Location>::const_iterator;
    enum class SnakePart
    {
       Head,
       Tail
    };
 
+   static constexpr int MaxLength = 65;
+
+   class const_iterator
+   {
+   public:
+      using iterator_category = std::input_iterator_tag;
+      using value_type = Location;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const Location*;
+      using reference = Location;
+
+      const_iterator(const Snake* aSnakePtr, const int aSegment, const int aCell)
+         : mSnakePtr{ aSnakePtr }
+         , mSegment{ aSegment }
+         , mCell{ aCell }
+      {}
+
+      Location operator*() const { return mSnakePtr->CellLocation(mCell); }
+      const_iterator& operator++();
+      const_iterator operator++(int);
+
+      bool operator==(const const_iterator& aRhs) const { return mSegment == aRhs.mSegment; }
+      bool operator!=(const const_iterator& aRhs) const { return mSegment != aRhs.mSegment; }
+
+   private:
+      const Snake* mSnakePtr;
+      int mSegment;
+      int mCell;
+   };
+
    Snake() = default;
 
-   const_iterator cbegin() const noexcept { return mBody.cbegin(); }
-   const_iterator cend() const noexcept { return mBody.cend(); }
+   const_iterator cbegin() const noexcept { return { this, 0, mHead }; }
+   const_iterator cend() const noexcept { return { this, mLength, mTail }; }
 
    int GetIdx() const { return mIdx; }
+   int GetLength() const { return mLength; }
+   int GetStride() const { return mStride; }
    bool OccupiesLocation(const Location& aLocation) const;
-   const Location& GetPartLocation(const SnakePart aPart) const;
+   Location GetPartLocation(const SnakePart aPart) const;
+   int GetPartCell(const SnakePart aPart) const { return aPart == SnakePart::Head ? mHead : mTail; }
+
+   // returns the cell vacated by the opposite end
+   int MakeMove(const SnakePart aPart, const Direction aDirection);
+
+   // takes back a move of aPart by moving the opposite end back into the
+   // cell it vacated; returns the cell the move had entered
+   int UnmakeMove(const SnakePart aPart, const int aVacated);
 
-   void MakeMove(const SnakePart aPart, const Direction aDirection);
+   // direction from part aLink to part aLink + 1, counting from the head
+   Direction GetLink(const int aLink) const
+   {
+      return static_cast<Direction>((mChain[aLink >> 5] >> ((aLink & 31) * 2)) & 3u);
+   }
+
+   // whether the bits of the links past the tail are all clear, as they
+   // are in every snake built or moved here; operator== and Hash see them
+   bool IsChainTrimmed() const;
 
    size_t Hash() const;
 
    bool operator==(const Snake& aRhs) const;
 
+   static int CellOffset(const Direction aDirection, const int aStride)
+   {
+      switch (aDirection)
+      {
+      case Direction::Up:
+         return -aStride;
+      case Direction::Right:
+         return 1;
+      case Direction::Down:
+         return aStride;
+      case Direction::Left:
+      default:
+         return -1;
+      }
+   }
+
 private:
-   std::deque<Location> mBody;
-   int mIdx = 0;
+   void SetLink(const int aLink, const Direction aDirection);
+
+   Location CellLocation(const int aCell) const
+   {
+      return { aCell % mStride - 1, aCell / mStride - 1 };
+   }
+
+   // link i is the direction from segment i to segment i + 1
+   std::array<std::uint64_t, 2> mChain{};
+   std::uint16_t mHead = 0;
+   std::uint16_t mTail = 0;
+   std::uint16_t mStride = 0;
+   std::uint8_t mLength = 0;
+   std::uint8_t mIdx = 0;
 
 public:
    class Builder
    {
    public:
-      Builder()
+      Builder(const int aStride)
          : mSnakePtr{ std::make_unique<Snake>() }
-      {}
+      {
+         mSnakePtr->mStride = static_cast<std::uint16_t>(aStride);
+      }
 
       void SetHead(const Location& aLoc);
       void AddSegment(const Direction aDirection);
@@ -54,6 +138,10 @@ public:
    };
 };
 
+// snakes are copied and compared as raw bytes
+static_assert(sizeof(Snake) == 24, "Snake should pack into 24 bytes");
+static_assert(std::has_unique_object_representations_v<Snake>, "Snake must not contain padding");
+
 namespace std
 {
 template<>
@@ -0,0 +1,310 @@
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+#include "SolutionCache.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define WRIGGLE_HAS_FLOCK 1
+#endif
+
+namespace
+{
+// the file starts with a header and then holds records back to back, each
+// a RecordHeader and its packed moves, padded to a multiple of 8 bytes
+struct FileHeader
+{
+   char mMagic[4];
+   std::uint32_t mVersion;
+};
+
+struct RecordHeader
+{
+   std::uint32_t mMagic;
+   std::uint32_t mMoveCount;
+   std::uint64_t mKeyHigh;
+   std::uint64_t mKeyLow;
+   std::int64_t mWallTimeNs;
+   std::uint8_t mOptimal;
+   char mSolver[SolutionCache::MaxSolverName];
+
+   // over the whole record, taken with this field zero
+   std::uint64_t mChecksum;
+};
+
+static_assert(sizeof(RecordHeader) % 8 == 0, "records must stay 8-byte aligned");
+
+constexpr char FileMagic[4] = { 'W', 'S', 'L', 'C' };
+constexpr std::uint32_t FileVersion = 1;
+constexpr std::uint32_t RecordMagic = 0x43455257; // "WREC"
+
+size_t RecordBytes(const std::uint32_t aMoveCount)
+{
+   const size_t movesBytes = aMoveCount * sizeof(std::uint16_t);
+   return sizeof(RecordHeader) + (movesBytes + 7) / 8 * 8;
+}
+
+std::uint64_t Fnv1a(const char* aData, const size_t aSize, std::uint64_t aHash = 0xcbf29ce484222325ull)
+{
+   for (size_t i = 0; i < aSize; ++i)
+   {
+      aHash = (aHash ^ static_cast<unsigned char>(aData[i])) * 0x100000001b3ull;
+   }
+   return aHash;
+}
+
+// a second hash, independent of Fnv1a, over 8-byte words
+std::uint64_t MixWords(const char* aData, const size_t aSize)
+{
+   std::uint64_t hash = 0x9e3779b97f4a7c15ull ^ aSize;
+   for (size_t i = 0; i < aSize; i += 8)
+   {
+      std::uint64_t word = 0;
+      std::memcpy(&word, aData + i, std::min<size_t>(8, aSize - i));
+      hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+      hash ^= hash >> 32;
+   }
+   return hash;
+}
+
+std::uint64_t RecordChecksum(const char* aRecord, const size_t aBytes)
+{
+   RecordHeader header;
+   std::memcpy(&header, aRecord, sizeof(header));
+   header.mChecksum = 0;
+   const std::uint64_t hash = Fnv1a(reinterpret_cast<const char*>(&header), sizeof(header));
+   return Fnv1a(aRecord + sizeof(header), aBytes - sizeof(header), hash);
+}
+
+size_t FileSize(const std::string& aPath)
+{
+   std::error_code error;
+   const auto size = std::filesystem::file_size(aPath, error);
+   return error ? 0 : static_cast<size_t>(size);
+}
+
+// appends aBytes to the file in one piece, creating the file if needed;
+// with aOnlyIfEmpty nothing is written to a file that has any contents.
+// writers hold an exclusive lock, so records of different processes never
+// interleave
+bool AppendLocked(const std::string& aPath, const std::string& aBytes, const bool aOnlyIfEmpty)
+{
+#ifdef WRIGGLE_HAS_FLOCK
+   const int fd = ::open(aPath.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+   if (fd < 0)
+   {
+      return false;
+   }
+   bool written = ::flock(fd, LOCK_EX) == 0;
+   struct stat info;
+   if (written && aOnlyIfEmpty && ::fstat(fd, &info) == 0 && info.st_size > 0)
+   {
+      ::close(fd);
+      return true;
+   }
+   for (size_t done = 0; written && done < aBytes.size();)
+   {
+      const ssize_t count = ::write(fd, aBytes.data() + done, aBytes.size() - done);
+      written = count > 0;
+      done += written ? static_cast<size_t>(count) : 0;
+   }
+   // closing releases the lock
+   ::close(fd);
+   return written;
+#else
+   if (aOnlyIfEmpty && FileSize(aPath) > 0)
+   {
+      return true;
+   }
+   std::ofstream out{ aPath, std::ios::binary | std::ios::app };
+   out.write(aBytes.data(), static_cast<std::streamsize>(aBytes.size()));
+   return static_cast<bool>(out);
+#endif
+}
+
+// maps the file under a shared lock, so that no record is half written
+std::unique_ptr<MappedFile> MapLocked(const std::string& aPath)
+{
+#ifdef WRIGGLE_HAS_FLOCK
+   const int fd = ::open(aPath.c_str(), O_RDONLY);
+   if (fd < 0)
+   {
+      throw std::runtime_error("cannot read " + aPath);
+   }
+   ::flock(fd, LOCK_SH);
+   std::unique_ptr<MappedFile> filePtr;
+   try
+   {
+      filePtr = std::make_unique<MappedFile>(aPath);
+   }
+   catch (...)
+   {
+      ::close(fd);
+      throw;
+   }
+   ::close(fd);
+   return filePtr;
+#else
+   return std::make_unique<MappedFile>(aPath);
+#endif
+}
+}
+
+SolutionCache::SolutionCache(const std::string& aPath)
+   : mPath{ aPath }
+{
+   FileHeader header;
+   std::memcpy(header.mMagic, FileMagic, sizeof(FileMagic));
+   header.mVersion = FileVersion;
+   if (!AppendLocked(mPath, std::string(reinterpret_cast<const char*>(&header), sizeof(header)), true))
+   {
+      throw std::runtime_error("cannot write " + mPath);
+   }
+
+   mFilePtr = MapLocked(mPath);
+   if (mFilePtr->Size() < sizeof(header) || std::memcmp(mFilePtr->Data(), FileMagic, sizeof(FileMagic)) != 0)
+   {
+      throw std::runtime_error(mPath + " is not a solution cache");
+   }
+   std::memcpy(&header, mFilePtr->Data(), sizeof(header));
+   if (header.mVersion != FileVersion)
+   {
+      throw std::runtime_error(mPath + " is a solution cache of another version");
+   }
+   mIndexedBytes = sizeof(header);
+   Refresh();
+}
+
+SolutionCache::Key SolutionCache::KeyOf(const Board& aBoard)
+{
+   // the binary format holds the walls and the snakes and nothing else,
+   // and is the same for equal puzzles however they were read
+   std::ostringstream bytes;
+   aBoard.WriteBinary(bytes);
+   const std::string data = bytes.str();
+   return Key{ Fnv1a(data.data(), data.size()), MixWords(data.data(), data.size()) };
+}
+
+bool SolutionCache::Find(const Key& aKey, Entry& aEntry)
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   auto it = mIndex.find(aKey);
+   if (it == mIndex.end())
+   {
+      // another process may have solved it since
+      Refresh();
+      it = mIndex.find(aKey);
+      if (it == mIndex.end())
+      {
+         return false;
+      }
+   }
+
+   const char* recordPtr = mFilePtr->Data() + it->second.mOffset;
+   RecordHeader header;
+   std::memcpy(&header, recordPtr, sizeof(header));
+   aEntry.mSolver.assign(header.mSolver, std::find(header.mSolver, header.mSolver + MaxSolverName, '\0'));
+   aEntry.mOptimal = header.mOptimal != 0;
+   aEntry.mWallTime = std::chrono::nanoseconds{ header.mWallTimeNs };
+   aEntry.mMoves.resize(header.mMoveCount);
+   for (std::uint32_t i = 0; i < header.mMoveCount; ++i)
+   {
+      std::uint16_t packed;
+      std::memcpy(&packed, recordPtr + sizeof(header) + i * sizeof(packed), sizeof(packed));
+      aEntry.mMoves[i] = Board::Move::Unpack(packed);
+   }
+   return true;
+}
+
+bool SolutionCache::Store(const Key& aKey, const Entry& aEntry)
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   Refresh();
+   const std::uint32_t moveCount = static_cast<std::uint32_t>(aEntry.mMoves.size());
+   const auto it = mIndex.find(aKey);
+   if (it != mIndex.end() && !IsBetter(aEntry.mOptimal, moveCount, it->second))
+   {
+      return true;
+   }
+
+   std::string record(RecordBytes(moveCount), '\0');
+   RecordHeader header{};
+   header.mMagic = RecordMagic;
+   header.mMoveCount = moveCount;
+   header.mKeyHigh = aKey.mHigh;
+   header.mKeyLow = aKey.mLow;
+   header.mWallTimeNs = static_cast<std::int64_t>(aEntry.mWallTime.count());
+   header.mOptimal = aEntry.mOptimal ? 1 : 0;
+   std::memcpy(header.mSolver, aEntry.mSolver.data(), std::min(aEntry.mSolver.size(), MaxSolverName));
+   std::memcpy(&record[0], &header, sizeof(header));
+   for (std::uint32_t i = 0; i < moveCount; ++i)
+   {
+      const std::uint16_t packed = aEntry.mMoves[i].Pack();
+      std::memcpy(&record[sizeof(header) + i * sizeof(packed)], &packed, sizeof(packed));
+   }
+   header.mChecksum = RecordChecksum(record.data(), record.size());
+   std::memcpy(&record[0], &header, sizeof(header));
+
+   if (!AppendLocked(mPath, record, false))
+   {
+      return false;
+   }
+   Refresh();
+   return true;
+}
+
+size_t SolutionCache::Size() const
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   return mIndex.size();
+}
+
+void SolutionCache::Refresh()
+{
+   if (FileSize(mPath) > mFilePtr->Size())
+   {
+      mFilePtr = MapLocked(mPath);
+   }
+
+   const char* data = mFilePtr->Data();
+   const size_t size = mFilePtr->Size();
+   while (mIndexedBytes + sizeof(RecordHeader) <= size)
+   {
+      RecordHeader header;
+      std::memcpy(&header, data + mIndexedBytes, sizeof(header));
+      const size_t recordBytes = RecordBytes(header.mMoveCount);
+      if (header.mMagic == RecordMagic && mIndexedBytes + recordBytes > size)
+      {
+         // cut short by a writer that died; records appended after it
+         // are reached once the file grows past the end it claims
+         break;
+      }
+      if (header.mMagic != RecordMagic || RecordChecksum(data + mIndexedBytes, recordBytes) != header.mChecksum)
+      {
+         // skip damaged bytes up to the next record
+         mIndexedBytes += 8;
+         continue;
+      }
+
+      Index(Key{ header.mKeyHigh, header.mKeyLow }, IndexEntry{ mIndexedBytes, header.mMoveCount, header.mOptimal != 0 });
+      mIndexedBytes += recordBytes;
+   }
+}
+
+void SolutionCache::Index(const Key& aKey, const IndexEntry& aEntry)
+{
+   const auto inserted = mIndex.emplace(aKey, aEntry);
+   if (!inserted.second && IsBetter(aEntry.mOptimal, aEntry.mMoveCount, inserted.first->second))
+   {
+      inserted.first->second = aEntry;
+   }
+}
@@ -0,0 +1,108 @@
+
+#ifndef SOLUTIONCACHE_HPP
+#define SOLUTIONCACHE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Board.hpp"
+#include "MappedFile.hpp"
+
+// solutions kept on disk across runs, keyed by a 128-bit hash of the
+// puzzle. the file is a log that is only ever appended to, one record per
+// solution, so several processes can share it: writers append whole
+// records under a file lock, and readers map the file and index the
+// records once, picking up records appended by others when they miss.
+// one cache may be used from several threads
+class SolutionCache
+{
+public:
+   // hash of the walls and the initial snakes, the same in every run
+   struct Key
+   {
+      std::uint64_t mHigh = 0;
+      std::uint64_t mLow = 0;
+
+      bool operator==(const Key& aRhs) const
+      {
+         return mHigh == aRhs.mHigh && mLow == aRhs.mLow;
+      }
+   };
+
+   struct Entry
+   {
+      std::string mSolver;
+      bool mOptimal = false;
+      std::vector<Board::Move> mMoves;
+
+      // time the search that found the solution took
+      std::chrono::nanoseconds mWallTime{ 0 };
+   };
+
+   // longest solver name kept with a solution
+   static constexpr size_t MaxSolverName = 15;
+
+   SolutionCache() = delete;
+
+   // opens the cache file, creating it if it does not exist; throws
+   // std::runtime_error if it cannot be created or is not a cache file
+   explicit SolutionCache(const std::string& aPath);
+
+   static Key KeyOf(const Board& aBoard);
+
+   // the best solution known for aKey: an optimal one if there is any,
+   // then the shortest; returns false if there is none
+   bool Find(const Key& aKey, Entry& aEntry);
+
+   // appends aEntry unless a solution as good is already known; returns
+   // false if the file could not be written
+   bool Store(const Key& aKey, const Entry& aEntry);
+
+   // solutions indexed so far, one per key
+   size_t Size() const;
+
+private:
+   struct KeyHash
+   {
+      size_t operator()(const Key& aKey) const
+      {
+         return static_cast<size_t>(aKey.mLow);
+      }
+   };
+
+   // where the best record of a key starts in the file
+   struct IndexEntry
+   {
+      size_t mOffset;
+      std::uint32_t mMoveCount;
+      bool mOptimal;
+   };
+
+   // maps the file again if it has grown and indexes the new records;
+   // called with mMutex held
+   void Refresh();
+
+   // adds the record unless a better one is indexed for its key
+   void Index(const Key& aKey, const IndexEntry& aEntry);
+
+   static bool IsBetter(const bool aOptimal, const std::uint32_t aMoveCount, const IndexEntry& aThan)
+   {
+      return aOptimal != aThan.mOptimal ? aOptimal : aMoveCount < aThan.mMoveCount;
+   }
+
+   std::string mPath;
+   mutable std::mutex mMutex;
+   std::unique_ptr<MappedFile> mFilePtr;
+
+   // bytes of the file that have been indexed, always at a record boundary
+   size_t mIndexedBytes = 0;
+   std::unordered_map<Key, IndexEntry, KeyHash> mIndex;
+};
+
+#endif
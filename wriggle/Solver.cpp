@@ -1,16 +1,79 @@
-
 #include "Solver.hpp"
 
 #include <array>
+#include <climits>
+#include <cmath>
+#include <cstring>
 #include <iostream>
 
 void Solver::Exec()
 {
    using std::chrono::system_clock;
    system_clock::time_point start = system_clock::now();
-   this->Solve();
+   mStart = std::chrono::steady_clock::now();
+   mNextCheck = 0;
+   mNextProgress = mProgressInterval;
+
+   SolutionCache::Key key;
+   if (mSolutionCachePtr)
+   {
+      key = SolutionCache::KeyOf(*mInitialPtr);
+      mFromCache = ReplayCached(key);
+   }
+   if (!mFromCache)
+   {
+      this->Solve();
+   }
    system_clock::time_point end = system_clock::now();
    mWallTime = std::chrono::duration_cast<wall_time>(end - start);
+
+   // the cache is only a speed-up, so a failed write is not an error
+   if (mSolutionCachePtr && !mFromCache && mSolved)
+   {
+      SolutionCache::Entry entry;
+      entry.mSolver = GetName();
+      entry.mOptimal = IsOptimal();
+      entry.mMoves.assign(mMoves.begin(), mMoves.end());
+      entry.mWallTime = mWallTime;
+      mSolutionCachePtr->Store(key, entry);
+   }
+}
+
+bool Solver::ReplayCached(const SolutionCache::Key& aKey)
+{
+   // a solver that promises a shortest solution does not take one that is
+   // not known to be
+   SolutionCache::Entry entry;
+   if (!mSolutionCachePtr->Find(aKey, entry) || (!entry.mOptimal && IsOptimal()))
+   {
+      return false;
+   }
+
+   // every move is checked, so a hash collision or a damaged record can
+   // only cost a search
+   Board board = *mInitialPtr;
+   std::vector<Board::Move> legalMoves;
+   for (const auto& move : entry.mMoves)
+   {
+      // LegalMoves appends
+      legalMoves.clear();
+      board.LegalMoves(legalMoves);
+      if (std::find(legalMoves.begin(), legalMoves.end(), move) == legalMoves.end())
+      {
+         return false;
+      }
+      board.MakeMove(move);
+   }
+   if (!board.IsSolved())
+   {
+      return false;
+   }
+
+   mSolved = true;
+   mMoves.assign(entry.mMoves.begin(), entry.mMoves.end());
+   mSolvedPtr = std::make_unique<Board>(board);
+   mCacheHit = std::move(entry);
+   return true;
 }
 
 void Solver::PrintToStream(std::ostream& aOut) const
@@ -40,235 +103,694 @@ void Solver::PrintToStream(std::ostream& aOut) const
    aOut << numMoves << std::endl;
 }
 
+void Solver::PrintJson(std::ostream& aOut) const
+{
+   Board board = *mInitialPtr;
+   const int numMoves = static_cast<int>(mMoves.size());
+
+   // moves as in PrintToStream: snake, part and the cell the part moved to
+   aOut << "{\"solver\":\"" << GetName() << "\",\"solved\":" << (mSolved ? "true" : "false")
+      << ",\"stop_reason\":\"" << GetStopReasonName(mStopReason) << '"'
+      << ",\"wall_time_ns\":" << mWallTime.count()
+      << ",\"move_count\":" << numMoves;
+   if (mFromCache)
+   {
+      aOut << ",\"cache\":{\"solver\":\"" << mCacheHit.mSolver << "\",\"optimal\":"
+         << (mCacheHit.mOptimal ? "true" : "false") << ",\"wall_time_ns\":" << mCacheHit.mWallTime.count() << '}';
+   }
+   aOut << ",\"moves\":[";
+   const char* separator = "";
+   for (const auto& move : mMoves)
+   {
+      board.MakeMove(move);
+      const Location moveLoc = board.GetSnakePartLocation(move.mSnakeIdx, move.mSnakePart);
+      aOut << separator << '[' << move.mSnakeIdx << ',' << static_cast<int>(move.mSnakePart) << ','
+         << moveLoc.GetX() << ',' << moveLoc.GetY() << ']';
+      separator = ",";
+   }
+   aOut << "],\"stats\":";
+   mStats.PrintJson(aOut, mSolved ? numMoves : 0);
+   aOut << '}';
+}
+
+const char* Solver::GetStopReasonName(const StopReason aReason)
+{
+   switch (aReason)
+   {
+   case StopReason::TimeLimit:
+      return "time limit";
+   case StopReason::NodeLimit:
+      return "node limit";
+   case StopReason::MemoryLimit:
+      return "memory limit";
+   default:
+      return "none";
+   }
+}
+
+size_t Solver::MemoryBytes() const
+{
+   return mBoards.Size() * (sizeof(Board) + mInitialPtr->GetStateBytes());
+}
+
+bool Solver::CheckLimitsNow(const size_t aExpanded, const int aBound, const size_t aFrontierSize)
+{
+   const wall_time elapsed = std::chrono::duration_cast<wall_time>(std::chrono::steady_clock::now() - mStart);
+   const bool progressDue = mProgressCallback && aExpanded >= mNextProgress;
+   const size_t memoryBytes = mMemoryLimit > 0 || progressDue ? MemoryBytes() : 0;
+
+   if (progressDue)
+   {
+      mNextProgress = aExpanded + mProgressInterval;
+      mProgressCallback(Progress{ aExpanded, aFrontierSize, memoryBytes, aBound, elapsed });
+   }
+   mNextCheck = aExpanded + LimitCheckInterval;
+   if (mProgressCallback)
+   {
+      mNextCheck = std::min(mNextCheck, mNextProgress);
+   }
+
+   if (mNodeLimit > 0 && aExpanded >= mNodeLimit)
+   {
+      mStopReason = StopReason::NodeLimit;
+   }
+   else if (mTimeLimit.count() > 0 && elapsed >= mTimeLimit)
+   {
+      mStopReason = StopReason::TimeLimit;
+   }
+   else if (mMemoryLimit > 0 && memoryBytes >= mMemoryLimit)
+   {
+      mStopReason = StopReason::MemoryLimit;
+   }
+   else
+   {
+      return false;
+   }
+
+   Cancel();
+   return true;
+}
+
+const Board& Solver::GetNodeBoard(const SearchNode* aNodePtr)
+{
+   if (aNodePtr->mBoardPtr)
+   {
+      return *aNodePtr->mBoardPtr;
+   }
+
+   mReplayMoves.clear();
+   while (!aNodePtr->mBoardPtr)
+   {
+      mReplayMoves.push_back(aNodePtr->mParentMove);
+      aNodePtr = aNodePtr->mParentPtr;
+   }
+
+   mNodeScratch = *aNodePtr->mBoardPtr;
+   for (auto it = mReplayMoves.crbegin(); it != mReplayMoves.crend(); ++it)
+   {
+      mNodeScratch.MakeMove(Board::Move::Unpack(*it));
+   }
+   return mNodeScratch;
+}
+
+const Board& Solver::MakeChildBoard(const Board& aParentBoard, const Board::Move& aMove)
+{
+   mChildScratch = aParentBoard;
+   mChildScratch.MakeMove(aMove);
+   return mChildScratch;
+}
+
+void Solver::TraceSolution(const SearchNode* aSolutionPtr)
+{
+   mSolvedPtr = std::make_unique<Board>(GetNodeBoard(aSolutionPtr));
+   while (aSolutionPtr->mParentPtr)
+   {
+      mMoves.push_front(aSolutionPtr->GetParentMove());
+      aSolutionPtr = aSolutionPtr->mParentPtr;
+   }
+}
+
+int Solver::ExitLowerBound(const Board& aBoard)
+{
+   if (aBoard.IsSolved())
+   {
+      return 0;
+   }
+
+   const BoardLayout& layout = aBoard.GetLayout();
+   const Snake& snake = aBoard.GetSnake(0);
+   return std::min(layout.ExitDistance(snake.GetPartCell(Snake::SnakePart::Head)),
+      layout.ExitDistance(snake.GetPartCell(Snake::SnakePart::Tail)));
+}
+
+int Solver::DistanceFieldHeuristic(const Board& aBoard) const
+{
+   if (mHeuristicKind != HeuristicKind::BlockedDistanceField || aBoard.IsSolved())
+   {
+      return ExitLowerBound(aBoard);
+   }
+
+   const BoardLayout& layout = aBoard.GetLayout();
+   const Snake& snake = aBoard.GetSnake(0);
+   int best = BoardLayout::Unreachable;
+   for (const auto part : { Snake::SnakePart::Head, Snake::SnakePart::Tail })
+   {
+      int cell = snake.GetPartCell(part);
+      int distance = layout.ExitDistance(cell);
+      if (distance >= best)
+      {
+         continue;
+      }
+
+      // walk downhill to the exit, going around snakes where the field allows
+      int blocked = 0;
+      const int total = distance;
+      while (distance > 0)
+      {
+         int next = -1;
+         for (int dir = 0; dir < 4; ++dir)
+         {
+            const int neighbor = layout.Neighbor(cell, static_cast<Direction>(dir));
+            if (layout.ExitDistance(neighbor) != distance - 1)
+            {
+               continue;
+            }
+            next = neighbor;
+            if (!aBoard.IsCellOccupiedBySnake(neighbor))
+            {
+               break;
+            }
+         }
+         cell = next;
+         --distance;
+         if (aBoard.IsCellOccupiedBySnake(cell))
+         {
+            ++blocked;
+         }
+      }
+      best = std::min(best, total + blocked);
+   }
+   return best;
+}
+
 void BreadthFirstTreeSearchSolver::Solve()
 {
-   mInitialNodePtr = std::make_unique<SearchNode>(nullptr, Board::Move{}, *mInitialPtr);
-   mFrontier.push_back(mInitialNodePtr.get());
+   mSeen.Insert(*mInitialPtr);
+   mFrontier.push_back(mNodes.New(nullptr, Board::Move{}, NewBoard(*mInitialPtr)));
 
    SearchNode* currentPtr = nullptr;
-   while (!mFrontier.empty())
+   while (!mFrontier.empty() && !IsCancelled())
    {
+      mStats.NoteFrontier(mFrontier.size());
       currentPtr = mFrontier.front();
       mFrontier.pop_front();
 
-      if (currentPtr->mBoardPtr->IsSolved())
+      const Board& board = GetNodeBoard(currentPtr);
+      if (board.IsSolved())
       {
          mSolved = true;
          break;
       }
-      else if (mExplored.count(*currentPtr->mBoardPtr))
+      else if (CheckLimits(mStats.mExpanded, currentPtr->mDepth, mFrontier.size()))
       {
-         continue;
+         break;
       }
 
-      mExplored.insert(*currentPtr->mBoardPtr);
-      std::vector<Board::Move> movesFromCurrent = currentPtr->mBoardPtr->LegalMoves();
+      ++mStats.mExpanded;
+      const int nextDepth = currentPtr->mDepth + 1;
+      std::vector<Board::Move> movesFromCurrent = board.LegalMoves();
+      mStats.mGenerated += movesFromCurrent.size();
       for (const auto& move : movesFromCurrent)
       {
-         auto nextNode = std::make_unique<SearchNode>(currentPtr, move, *currentPtr->mBoardPtr);
-         nextNode->mBoardPtr->MakeMove(move);
-         mFrontier.push_back(nextNode.get());
-         currentPtr->mChildren[move] = std::move(nextNode);
+         // states are generated in order of depth, so the first path to a
+         // state is a shortest one and later duplicates can be dropped here
+         const Board& nextBoard = MakeChildBoard(board, move);
+         if (mSeen.Insert(nextBoard))
+         {
+            mFrontier.push_back(mNodes.New(currentPtr, move, CheckpointBoard(nextBoard, nextDepth)));
+         }
+         else
+         {
+            ++mStats.mDuplicates;
+         }
       }
    }
+   mStats.mExploredSize = mSeen.Size();
 
    if (mSolved && currentPtr)
    {
-      mSolvedPtr = std::make_unique<Board>(*currentPtr->mBoardPtr);
-      while (currentPtr->mParentPtr)
-      {
-         mMoves.push_front(currentPtr->mParentMove);
-         currentPtr = currentPtr->mParentPtr;
-      }
+      TraceSolution(currentPtr);
    }
 }
 
+size_t BreadthFirstTreeSearchSolver::MemoryBytes() const
+{
+   return Solver::MemoryBytes() + mNodes.Size() * sizeof(SearchNode) + mSeen.MemoryBytes()
+      + mFrontier.size() * sizeof(SearchNode*);
+}
+
 void IterativeDeepeningDepthFirstTreeSearchSolver::Solve()
 {
    int maxDepth = 0;
-   SearchNode* solutionPtr = nullptr;
-   while (!mSolved)
+   while (!mSolved && !IsCancelled())
    {
-      solutionPtr = SolveToDepth(maxDepth);
+      mCutOff = false;
+      mSolved = SolveToDepth(maxDepth);
       ++maxDepth;
-      mExplored.clear();
+      mStats.NoteExplored(mExplored.Size());
+      mExplored.Clear();
+
+      // every reachable state was searched, so there is no solution
+      if (!mCutOff)
+      {
+         break;
+      }
    }
 
-   if (mSolved && solutionPtr)
+   if (mSolved)
    {
-      mSolvedPtr = std::make_unique<Board>(*solutionPtr->mBoardPtr);
-      while (solutionPtr->mParentPtr)
+      // the root's frame has no move leading to it
+      for (size_t i = 1; i < mPath.size(); ++i)
       {
-         mMoves.push_front(solutionPtr->mParentMove);
-         solutionPtr = solutionPtr->mParentPtr;
+         mMoves.push_back(mPath[i].mMove);
       }
+      mSolvedPtr = std::make_unique<Board>(mBoard);
    }
 }
 
-Solver::SearchNode* IterativeDeepeningDepthFirstTreeSearchSolver::SolveToDepth(const int aMaxDepth)
+bool IterativeDeepeningDepthFirstTreeSearchSolver::SolveToDepth(const int aMaxDepth)
 {
-   mInitialNodePtr = std::make_unique<SearchNode>(nullptr, Board::Move{}, *mInitialPtr);
-   mFrontier.push(mInitialNodePtr.get());
+   mBoard = *mInitialPtr;
+   mPath.clear();
+   mCandidates.clear();
 
-   SearchNode* currentPtr = nullptr;
-   while (!mFrontier.empty())
+   if (mBoard.IsSolved())
    {
-      currentPtr = mFrontier.top();
-      mFrontier.pop();
+      return true;
+   }
+   mExplored.Insert(mBoard);
+   if (aMaxDepth == 0)
+   {
+      mCutOff = true;
+      return false;
+   }
+   PushFrame(Board::Move{}, 0);
 
-      if (currentPtr->mBoardPtr->IsSolved())
+   while (!mPath.empty() && !IsCancelled())
+   {
+      if (CheckLimits(mStats.mExpanded, aMaxDepth, mCandidates.size()))
       {
-         mSolved = true;
-         return currentPtr;
+         return false;
       }
-      else if (mExplored.count(*currentPtr->mBoardPtr))
+
+      Frame& top = mPath.back();
+      if (top.mNextMove == top.mFirstMove)
       {
-         // this node has already been generated
+         // every move from here has been tried, step back to the parent
+         mCandidates.resize(top.mFirstMove);
+         if (mPath.size() > 1)
+         {
+            mBoard.UnmakeMove(top.mMove, top.mVacated);
+         }
+         mPath.pop_back();
          continue;
       }
 
-      mExplored.insert(*currentPtr->mBoardPtr);
-
-      if (currentPtr->mDepth >= aMaxDepth)
+      const Board::Move move = mCandidates[--top.mNextMove];
+      const int vacated = mBoard.MakeMove(move);
+      const int depth = static_cast<int>(mPath.size());
+      ++mStats.mGenerated;
+      if (mBoard.IsSolved())
+      {
+         mPath.push_back({ mCandidates.size(), mCandidates.size(), move, vacated });
+         return true;
+      }
+      else if (!mExplored.Insert(mBoard))
       {
-         // this node is at the depth limit, don't generate children
+         // this node has already been generated, don't generate children
+         ++mStats.mDuplicates;
+         mBoard.UnmakeMove(move, vacated);
+         continue;
+      }
+      else if (depth >= aMaxDepth)
+      {
+         // at the depth limit, don't generate children
+         mCutOff = true;
+         mBoard.UnmakeMove(move, vacated);
          continue;
       }
 
-      std::vector<Board::Move> movesFromCurrent = currentPtr->mBoardPtr->LegalMoves();
-      for (const auto& move : movesFromCurrent)
+      PushFrame(move, vacated);
+   }
+
+   return false;
+}
+
+void IterativeDeepeningDepthFirstTreeSearchSolver::PushFrame(const Board::Move& aMove, const int aVacated)
+{
+   const size_t firstMove = mCandidates.size();
+   mBoard.LegalMoves(mCandidates);
+   mPath.push_back({ firstMove, mCandidates.size(), aMove, aVacated });
+
+   // the untried moves are the nodes still to visit
+   ++mStats.mExpanded;
+   mStats.NoteFrontier(mCandidates.size());
+}
+
+size_t IterativeDeepeningDepthFirstTreeSearchSolver::MemoryBytes() const
+{
+   return mExplored.MemoryBytes() + mPath.capacity() * sizeof(Frame) + mCandidates.capacity() * sizeof(Board::Move);
+}
+
+void IterativeDeepeningAStarSolver::Solve()
+{
+   int bound = LowerBound(*mInitialPtr);
+   mStats.mInitialEstimate = bound;
+   while (!IsCancelled())
+   {
+      const int result = Search(0, bound);
+      if (result == Found)
       {
-         auto nextNode = std::make_unique<SearchNode>(currentPtr, move, *currentPtr->mBoardPtr);
-         nextNode->mBoardPtr->MakeMove(move);
-         mFrontier.push(nextNode.get());
-         currentPtr->mChildren[move] = std::move(nextNode);
+         mSolved = true;
+         mMoves.assign(mPathMoves.begin(), mPathMoves.end());
+         mSolvedPtr = std::make_unique<Board>(mBoard);
+         break;
       }
+      else if (result == INT_MAX)
+      {
+         // nothing was cut off by the bound, so no solution exists
+         break;
+      }
+      bound = result;
+   }
+}
+
+int IterativeDeepeningAStarSolver::Search(const int aDepth, const int aBound)
+{
+   const int lowerBound = LowerBound(mBoard);
+   if (IsUnreachable(lowerBound))
+   {
+      // no bound is high enough to reach a solution from here
+      return INT_MAX;
+   }
+
+   const int score = aDepth + lowerBound;
+   if (score > aBound)
+   {
+      return score;
+   }
+   else if (mBoard.IsSolved())
+   {
+      return Found;
+   }
+   else if (IsCancelled() || CheckLimits(mStats.mExpanded, aBound, mCandidates.size()))
+   {
+      return INT_MAX;
+   }
+   else if (!Probe(mBoard, aDepth, aBound))
+   {
+      ++mStats.mDuplicates;
+      return INT_MAX;
    }
 
-   return nullptr;
+   // deeper calls push past the end, so the range is indexed rather than
+   // iterated
+   int minExceeded = INT_MAX;
+   const size_t firstMove = mCandidates.size();
+   mBoard.LegalMoves(mCandidates);
+   const size_t endMove = mCandidates.size();
+   ++mStats.mExpanded;
+   mStats.mGenerated += endMove - firstMove;
+   mStats.NoteFrontier(mCandidates.size());
+   for (size_t i = firstMove; i < endMove; ++i)
+   {
+      const Board::Move move = mCandidates[i];
+      const int vacated = mBoard.MakeMove(move);
+      mPathMoves.push_back(move);
+
+      const int result = Search(aDepth + 1, aBound);
+      if (result == Found)
+      {
+         return Found;
+      }
+      mPathMoves.pop_back();
+      mBoard.UnmakeMove(move, vacated);
+      minExceeded = std::min(minExceeded, result);
+   }
+   mCandidates.resize(firstMove);
+   return minExceeded;
+}
+
+bool IterativeDeepeningAStarSolver::Probe(const Board& aBoard, const int aDepth, const int aBound)
+{
+   const std::uint64_t key = aBoard.Hash();
+   const std::uint64_t check = StateCheck(aBoard);
+   TableEntry& entry = mTable[static_cast<size_t>(key) & (mTable.size() - 1)];
+   if (entry.mBound == aBound)
+   {
+      const bool same = entry.mKey == key && entry.mCheck == check;
+      if (same && entry.mDepth <= aDepth)
+      {
+         return false;
+      }
+      else if (!same && entry.mDepth < aDepth)
+      {
+         return true;
+      }
+   }
+
+   // entries of earlier iterations stay in use
+   if (entry.mBound < 0)
+   {
+      ++mStats.mExploredSize;
+   }
+   entry.mKey = key;
+   entry.mCheck = check;
+   entry.mBound = aBound;
+   entry.mDepth = aDepth;
+   return true;
+}
+
+size_t IterativeDeepeningAStarSolver::MemoryBytes() const
+{
+   return mTable.size() * sizeof(TableEntry) + mPathMoves.capacity() * sizeof(Board::Move)
+      + mCandidates.capacity() * sizeof(Board::Move);
+}
+
+std::uint64_t IterativeDeepeningAStarSolver::StateCheck(const Board& aBoard)
+{
+   const auto* bytesPtr = static_cast<const unsigned char*>(aBoard.GetStateData());
+   std::uint64_t check = 0;
+   for (size_t i = 0; i + sizeof(std::uint64_t) <= aBoard.GetStateBytes(); i += sizeof(std::uint64_t))
+   {
+      std::uint64_t word;
+      std::memcpy(&word, bytesPtr + i, sizeof(word));
+      check = (check ^ word) * 0x9E3779B97F4A7C15ull;
+      check ^= check >> 29;
+   }
+   return check;
 }
 
 void GreedyBestFirstGraphSearchSolver::Solve()
 {
-   mInitialNodePtr = std::make_unique<SearchNode>(nullptr, Board::Move{}, *mInitialPtr);
-   mFrontier.push(mInitialNodePtr.get());
+   if (mOpenListKind == OpenListKind::Buckets)
+   {
+      Search(mBucketFrontier);
+   }
+   else
+   {
+      Search(mFrontier);
+   }
+}
+
+template <typename OpenList>
+void GreedyBestFirstGraphSearchSolver::Search(OpenList& aFrontier)
+{
+   bool inserted;
+   SearchNode* initialNodePtr = mNodes.New(nullptr, Board::Move{}, NewBoard(*mInitialPtr), Estimate(*mInitialPtr));
+   mStates.SetValue(mStates.FindOrInsert(*mInitialPtr, inserted), initialNodePtr);
+   aFrontier.Push(initialNodePtr);
+   mStats.mInitialEstimate = initialNodePtr->mHeuristicScore;
 
    SearchNode* currentPtr = nullptr;
-   while (!mFrontier.empty())
+   while (!aFrontier.Empty() && !IsCancelled())
    {
-      currentPtr = mFrontier.top();
-      mFrontier.pop();
+      mStats.NoteFrontier(aFrontier.Size());
+      currentPtr = aFrontier.Pop();
 
-      if (currentPtr->mBoardPtr->IsSolved())
+      const Board& board = GetNodeBoard(currentPtr);
+      if (board.IsSolved())
       {
          mSolved = true;
          break;
       }
-      else if (mExplored.count(*currentPtr->mBoardPtr))
+      else if (CheckLimits(mStats.mExpanded, Keys::Primary(currentPtr), aFrontier.Size()))
       {
-         continue;
+         break;
       }
 
-      mExplored.insert(*currentPtr->mBoardPtr);
-      std::vector<Board::Move> movesFromCurrent = currentPtr->mBoardPtr->LegalMoves();
+      ++mStats.mExpanded;
+      const int nextDepth = currentPtr->mDepth + 1;
+      std::vector<Board::Move> movesFromCurrent = board.LegalMoves();
+      mStats.mGenerated += movesFromCurrent.size();
       for (const auto& move : movesFromCurrent)
       {
-         auto nextNode = std::make_unique<SearchNode>(currentPtr, move, *currentPtr->mBoardPtr);
-         nextNode->mBoardPtr->MakeMove(move);
-         mFrontier.push(nextNode.get());
-         currentPtr->mChildren[move] = std::move(nextNode);
+         const Board& nextBoard = MakeChildBoard(board, move);
+         const size_t slot = mStates.FindOrInsert(nextBoard, inserted);
+         if (inserted)
+         {
+            SearchNode* nextPtr = mNodes.New(currentPtr, move, CheckpointBoard(nextBoard, nextDepth), Estimate(nextBoard));
+            mStates.SetValue(slot, nextPtr);
+            aFrontier.Push(nextPtr);
+            continue;
+         }
+
+         // expanded states are never reopened; queued ones keep the shorter path
+         ++mStats.mDuplicates;
+         auto* seenPtr = static_cast<SearchNode*>(mStates.GetValue(slot));
+         if (aFrontier.Contains(seenPtr) && nextDepth < seenPtr->mDepth)
+         {
+            seenPtr->Reparent(currentPtr, move);
+            aFrontier.DecreaseKey(seenPtr);
+         }
       }
    }
+   mStats.mExploredSize = mStates.Size();
 
    if (mSolved && currentPtr)
    {
-      mSolvedPtr = std::make_unique<Board>(*currentPtr->mBoardPtr);
-      while (currentPtr->mParentPtr)
-      {
-         mMoves.push_front(currentPtr->mParentMove);
-         currentPtr = dynamic_cast<GreedyBestFirstGraphSearchSolver::SearchNode*>(currentPtr->mParentPtr);
-      }
+      TraceSolution(currentPtr);
    }
 }
 
-int GreedyBestFirstGraphSearchSolver::Heuristic(const GreedyBestFirstGraphSearchSolver::SearchNode* aSearchNodePtr)
+size_t GreedyBestFirstGraphSearchSolver::MemoryBytes() const
+{
+   return Solver::MemoryBytes() + mNodes.Size() * sizeof(SearchNode) + mStates.MemoryBytes()
+      + (mFrontier.Size() + mBucketFrontier.Size()) * sizeof(SearchNode*);
+}
+
+int GreedyBestFirstGraphSearchSolver::Heuristic(const Board& aBoard)
 {
    // simple heuristic:
    // taxicab distance to exit for 0-snake
-   const Location& exitLoc = aSearchNodePtr->mBoardPtr->GetExitLocation();
-   Location diffHead = exitLoc - aSearchNodePtr->mBoardPtr->GetSnakePartLocation(0, Snake::SnakePart::Head);
-   Location diffTail = exitLoc - aSearchNodePtr->mBoardPtr->GetSnakePartLocation(0, Snake::SnakePart::Tail);
+   const Location& exitLoc = aBoard.GetExitLocation();
+   Location diffHead = exitLoc - aBoard.GetSnakePartLocation(0, Snake::SnakePart::Head);
+   Location diffTail = exitLoc - aBoard.GetSnakePartLocation(0, Snake::SnakePart::Tail);
 
    return std::min(diffHead.Taxicab(), diffTail.Taxicab());
 }
 
 void AStarSolver::Solve()
 {
-   mInitialNodePtr = std::make_unique<SearchNode>(nullptr, Board::Move{}, *mInitialPtr);
-   mFrontier.push(mInitialNodePtr.get());
+   if (mOpenListKind == OpenListKind::Buckets)
+   {
+      Search(mBucketFrontier);
+   }
+   else
+   {
+      Search(mFrontier);
+   }
+}
+
+template <typename OpenList>
+void AStarSolver::Search(OpenList& aFrontier)
+{
+   bool inserted;
+   int sweepDepth;
+   const int initialScore = Estimate(*mInitialPtr, sweepDepth);
+   mStats.mInitialEstimate = initialScore;
+   SearchNode* initialNodePtr = mNodes.New(nullptr, Board::Move{}, NewBoard(*mInitialPtr), initialScore, sweepDepth);
+   mStates.SetValue(mStates.FindOrInsert(*mInitialPtr, inserted), initialNodePtr);
+   aFrontier.Push(initialNodePtr);
 
    SearchNode* currentPtr = nullptr;
-   while (!mFrontier.empty())
+   while (!aFrontier.Empty() && !IsCancelled())
    {
-      currentPtr = mFrontier.top();
-      mFrontier.pop();
+      mStats.NoteFrontier(aFrontier.Size());
+      currentPtr = aFrontier.Pop();
 
-      if (currentPtr->mBoardPtr->IsSolved())
+      const Board& board = GetNodeBoard(currentPtr);
+      if (board.IsSolved())
       {
          mSolved = true;
          break;
       }
-      else if (mExplored.count(*currentPtr->mBoardPtr))
+      else if (CheckLimits(mStats.mExpanded, Keys::Primary(currentPtr), aFrontier.Size()))
       {
-         continue;
+         break;
       }
 
-      mExplored.insert(*currentPtr->mBoardPtr);
-      std::vector<Board::Move> movesFromCurrent = currentPtr->mBoardPtr->LegalMoves();
+      ++mStats.mExpanded;
+      const int nextDepth = currentPtr->mDepth + 1;
+      std::vector<Board::Move> movesFromCurrent = board.LegalMoves();
+      mStats.mGenerated += movesFromCurrent.size();
       for (const auto& move : movesFromCurrent)
       {
-         auto nextNode = std::make_unique<SearchNode>(currentPtr, move, *currentPtr->mBoardPtr);
-         nextNode->mBoardPtr->MakeMove(move);
-         mFrontier.push(nextNode.get());
-         currentPtr->mChildren[move] = std::move(nextNode);
+         const Board& nextBoard = MakeChildBoard(board, move);
+         const size_t slot = mStates.FindOrInsert(nextBoard, inserted);
+         if (inserted)
+         {
+            const int score = ChildEstimate(currentPtr, board, nextBoard, move, sweepDepth);
+            SearchNode* nextPtr = mNodes.New(currentPtr, move, CheckpointBoard(nextBoard, nextDepth), score, sweepDepth);
+            mStates.SetValue(slot, nextPtr);
+            aFrontier.Push(nextPtr);
+            continue;
+         }
+
+         // expanded states are never reopened; queued ones keep the shorter path
+         ++mStats.mDuplicates;
+         auto* seenPtr = static_cast<SearchNode*>(mStates.GetValue(slot));
+         if (aFrontier.Contains(seenPtr) && nextDepth < seenPtr->mDepth)
+         {
+            seenPtr->Reparent(currentPtr, move);
+            aFrontier.DecreaseKey(seenPtr);
+         }
       }
    }
+   mStats.mExploredSize = mStates.Size();
 
    if (mSolved && currentPtr)
    {
-      mSolvedPtr = std::make_unique<Board>(*currentPtr->mBoardPtr);
-      while (currentPtr->mParentPtr)
-      {
-         mMoves.push_front(currentPtr->mParentMove);
-         currentPtr = dynamic_cast<AStarSolver::SearchNode*>(currentPtr->mParentPtr);
-      }
+      TraceSolution(currentPtr);
    }
 }
 
-int AStarSolver::Heuristic(const AStarSolver::SearchNode* aSearchNodePtr)
+size_t AStarSolver::MemoryBytes() const
+{
+   return Solver::MemoryBytes() + mNodes.Size() * sizeof(SearchNode) + mStates.MemoryBytes()
+      + (mFrontier.Size() + mBucketFrontier.Size()) * sizeof(SearchNode*);
+}
+
+int AStarSolver::Heuristic(const Board& aBoard)
+{
+   int sweepDepth;
+   return Heuristic(aBoard, sweepDepth);
+}
+
+int AStarSolver::Heuristic(const Board& aBoard, int& aSweepDepth)
 {
    // slightly more advanced heuristic:
    // taxicab distance to exit for 0-snake + terrain penalty for adjacent spaces (1 for other snakes, 2 for walls)
-   const Location& exitLoc = aSearchNodePtr->mBoardPtr->GetExitLocation();
-   const Location& headLoc = aSearchNodePtr->mBoardPtr->GetSnakePartLocation(0, Snake::SnakePart::Head);
-   const Location& tailLoc = aSearchNodePtr->mBoardPtr->GetSnakePartLocation(0, Snake::SnakePart::Tail);
+   const Location& exitLoc = aBoard.GetExitLocation();
+   const Location& headLoc = aBoard.GetSnakePartLocation(0, Snake::SnakePart::Head);
+   const Location& tailLoc = aBoard.GetSnakePartLocation(0, Snake::SnakePart::Tail);
 
-   auto SnakePartPenalty = [aSearchNodePtr](const Location& aLoc) -> int
+   auto SnakePartPenalty = [&aBoard](const Location& aLoc) -> int
    {
       const std::array<Location, 2> downright = { aLoc.Nudge(Direction::Down), aLoc.Nudge(Direction::Right) };
       int penalty = 2;
 
       for (const auto& next : downright)
       {
-         if (!aSearchNodePtr->mBoardPtr->IsLocationInside(next))
+         if (!aBoard.IsLocationInside(next))
          {
             continue;
          }
-         else if (aSearchNodePtr->mBoardPtr->IsLocationOccupiedBySnake(next))
+         else if (aBoard.IsLocationOccupiedBySnake(next))
          {
             penalty = std::min(penalty, 1);
          }
-         else if (aSearchNodePtr->mBoardPtr->IsLocationEmpty(next))
+         else if (aBoard.IsLocationEmpty(next))
          {
             penalty = 0;
          }
@@ -279,21 +801,23 @@ int AStarSolver::Heuristic(const AStarSolver::SearchNode* aSearchNodePtr)
    int costHead = (exitLoc - headLoc).Taxicab() + SnakePartPenalty(headLoc);
    int costTail = (exitLoc - tailLoc).Taxicab() + SnakePartPenalty(tailLoc);
    int subtotalCost = std::min(costHead, costTail);
-   
+
    const Location& closerPart = subtotalCost == costHead ? headLoc : tailLoc;
 
    // adds penalty of 1 for each layer of blockage in front of the exit
-   auto BlockedExitPenalty = [aSearchNodePtr, closerPart, exitLoc]() -> int
+   auto BlockedExitPenalty = [&aBoard, &aSweepDepth, closerPart, exitLoc]() -> int
    {
       int totalPenalty = 0;
       int sweepPenalty = 0;
       int nudge = 0;
+      aSweepDepth = 0;
       Location checkLoc;
 
       while (nudge < exitLoc.Taxicab())
       {
          sweepPenalty = 1;
          nudge++;
+         aSweepDepth = nudge;
          checkLoc = exitLoc - Location{ nudge, 0 };
 
          while (checkLoc.GetX() <= exitLoc.GetX())
@@ -303,7 +827,7 @@ int AStarSolver::Heuristic(const AStarSolver::SearchNode* aSearchNodePtr)
                // we reached the closer part of the goal snake, immediately return result
                return totalPenalty;
             }
-            if (aSearchNodePtr->mBoardPtr->IsLocationEmpty(checkLoc) && aSearchNodePtr->mBoardPtr->IsLocationInside(checkLoc))
+            if (aBoard.IsLocationEmpty(checkLoc) && aBoard.IsLocationInside(checkLoc))
             {
                // this location is empty, sweep penalty is zero
                sweepPenalty = 0;
@@ -324,3 +848,224 @@ int AStarSolver::Heuristic(const AStarSolver::SearchNode* aSearchNodePtr)
 
    return subtotalCost + BlockedExitPenalty();
 }
+
+int AStarSolver::ChildEstimate(const SearchNode* aParentPtr, const Board& aParent, const Board& aChild,
+   const Board::Move& aMove, int& aSweepDepth) const
+{
+   if (aMove.mSnakeIdx == 0 || mHeuristicKind == HeuristicKind::BlockedDistanceField)
+   {
+      return Estimate(aChild, aSweepDepth);
+   }
+   else if (mPatternDatabasePtr || mHeuristicKind == HeuristicKind::DistanceField)
+   {
+      // these only look at the 0-snake
+      aSweepDepth = 0;
+      return aParentPtr->mHeuristicScore;
+   }
+
+   // a move only changes the cell the moving end enters and the cell the
+   // other end leaves
+   const Snake::SnakePart otherPart = aMove.mSnakePart == Snake::SnakePart::Head ? Snake::SnakePart::Tail : Snake::SnakePart::Head;
+   const int entered = aChild.GetSnake(aMove.mSnakeIdx).GetPartCell(aMove.mSnakePart);
+   const int vacated = aParent.GetSnake(aMove.mSnakeIdx).GetPartCell(otherPart);
+   if (IsSeenByHeuristic(aParent, entered, aParentPtr->mSweepDepth)
+      || IsSeenByHeuristic(aParent, vacated, aParentPtr->mSweepDepth))
+   {
+      return Heuristic(aChild, aSweepDepth);
+   }
+
+   aSweepDepth = aParentPtr->mSweepDepth;
+   return aParentPtr->mHeuristicScore;
+}
+
+bool AStarSolver::IsSeenByHeuristic(const Board& aBoard, const int aCell, const int aSweepDepth)
+{
+   // the diagonals swept in front of the exit, and the cells below and to
+   // the right of each end of the 0-snake
+   const Location loc = aBoard.GetLayout().CellLocation(aCell);
+   if ((aBoard.GetExitLocation() - loc).Taxicab() <= aSweepDepth)
+   {
+      return true;
+   }
+
+   for (const auto part : { Snake::SnakePart::Head, Snake::SnakePart::Tail })
+   {
+      const Location endLoc = aBoard.GetSnakePartLocation(0, part);
+      if (loc == endLoc.Nudge(Direction::Down) || loc == endLoc.Nudge(Direction::Right))
+      {
+         return true;
+      }
+   }
+   return false;
+}
+
+void AnytimeWeightedAStarSolver::Solve()
+{
+   mStart = std::chrono::steady_clock::now();
+   mRoundWeight = static_cast<int>(std::lround(mWeight * WeightScale));
+
+   bool inserted;
+   SearchNode* initialNodePtr = mNodes.New(nullptr, Board::Move{}, NewBoard(*mInitialPtr), Estimate(*mInitialPtr),
+      LowerBound(*mInitialPtr));
+   mStats.mInitialEstimate = initialNodePtr->mHeuristicScore;
+   mStates.SetValue(mStates.FindOrInsert(*mInitialPtr, inserted), initialNodePtr);
+   if (mInitialPtr->IsSolved())
+   {
+      mBestPtr = initialNodePtr;
+      mBestCost = 0;
+   }
+   else
+   {
+      SetPriority(initialNodePtr);
+      mFrontier.Push(initialNodePtr);
+   }
+
+   while (true)
+   {
+      const bool finished = ImprovePath();
+
+      // a better path may have been found to the same solution node, so
+      // the solution is traced again
+      if (mBestPtr)
+      {
+         mSolved = true;
+         mMoves.clear();
+         TraceSolution(mBestPtr);
+      }
+
+      mOptimal = finished && mRoundWeight == WeightScale && IsEstimateAdmissible();
+      if (!finished || !mAnytime || mRoundWeight == WeightScale)
+      {
+         break;
+      }
+      NextRound();
+   }
+   mStats.mExploredSize = mStates.Size();
+}
+
+bool AnytimeWeightedAStarSolver::ImprovePath()
+{
+   int sinceCheck = 0;
+   while (!mFrontier.Empty())
+   {
+      if (mBestPtr && mFrontier.Top()->mPriority >= mBestCost * WeightScale)
+      {
+         return true;
+      }
+      else if (IsCancelled())
+      {
+         return false;
+      }
+      else if (++sinceCheck == DeadlineCheckInterval)
+      {
+         sinceCheck = 0;
+         if (IsPastDeadline())
+         {
+            return false;
+         }
+      }
+      if (CheckLimits(mStats.mExpanded, mFrontier.Top()->mPriority / WeightScale, mFrontier.Size()))
+      {
+         return false;
+      }
+
+      mStats.NoteFrontier(mFrontier.Size());
+      SearchNode* currentPtr = mFrontier.Pop();
+      if (currentPtr->mDepth + currentPtr->mLowerBound >= mBestCost)
+      {
+         continue;
+      }
+      currentPtr->mClosedRound = mRound;
+      ++mStats.mExpanded;
+
+      const Board& board = GetNodeBoard(currentPtr);
+      const int nextDepth = currentPtr->mDepth + 1;
+      std::vector<Board::Move> movesFromCurrent = board.LegalMoves();
+      mStats.mGenerated += movesFromCurrent.size();
+      for (const auto& move : movesFromCurrent)
+      {
+         const Board& nextBoard = MakeChildBoard(board, move);
+         const int lowerBound = LowerBound(nextBoard);
+         if (nextDepth + lowerBound >= mBestCost)
+         {
+            continue;
+         }
+
+         bool inserted;
+         const size_t slot = mStates.FindOrInsert(nextBoard, inserted);
+         auto* nextPtr = static_cast<SearchNode*>(mStates.GetValue(slot));
+         if (inserted)
+         {
+            nextPtr = mNodes.New(currentPtr, move, CheckpointBoard(nextBoard, nextDepth), Estimate(nextBoard), lowerBound);
+            mStates.SetValue(slot, nextPtr);
+         }
+         else if (nextDepth < nextPtr->mDepth)
+         {
+            nextPtr->Reparent(currentPtr, move);
+         }
+         else
+         {
+            ++mStats.mDuplicates;
+            continue;
+         }
+
+         if (nextBoard.IsSolved())
+         {
+            mBestPtr = nextPtr;
+            mBestCost = nextDepth;
+         }
+         else if (nextPtr->mClosedRound == mRound)
+         {
+            // expanded in this round already; it is queued again next round
+            if (!nextPtr->mInconsistent)
+            {
+               nextPtr->mInconsistent = true;
+               mInconsistentNodes.push_back(nextPtr);
+            }
+         }
+         else
+         {
+            SetPriority(nextPtr);
+            if (mFrontier.Contains(nextPtr))
+            {
+               mFrontier.DecreaseKey(nextPtr);
+            }
+            else
+            {
+               mFrontier.Push(nextPtr);
+            }
+         }
+      }
+   }
+   return true;
+}
+
+void AnytimeWeightedAStarSolver::NextRound()
+{
+   ++mRound;
+   mRoundWeight = std::max(WeightScale, mRoundWeight - WeightStep);
+
+   std::vector<SearchNode*> open;
+   open.swap(mInconsistentNodes);
+   while (!mFrontier.Empty())
+   {
+      open.push_back(mFrontier.Pop());
+   }
+   for (SearchNode* nodePtr : open)
+   {
+      nodePtr->mInconsistent = false;
+      SetPriority(nodePtr);
+      mFrontier.Push(nodePtr);
+   }
+}
+
+size_t AnytimeWeightedAStarSolver::MemoryBytes() const
+{
+   return Solver::MemoryBytes() + mNodes.Size() * sizeof(SearchNode) + mStates.MemoryBytes()
+      + (mFrontier.Size() + mInconsistentNodes.size()) * sizeof(SearchNode*);
+}
+
+bool AnytimeWeightedAStarSolver::IsPastDeadline() const
+{
+   return mDeadline.count() > 0 && std::chrono::steady_clock::now() - mStart >= mDeadline;
+}
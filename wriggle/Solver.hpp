@@ -2,17 +2,30 @@
 #ifndef SOLVER_HPP
 #define SOLVER_HPP
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <climits>
+#include <deque>
+#include <functional>
 #include <iostream>
 #include <list>
 #include <map>
 #include <memory>
+#include <memory_resource>
 #include <queue>
 #include <stack>
 #include <unordered_map>
 #include <unordered_set>
 
 #include "Board.hpp"
+#include "BucketQueue.hpp"
+#include "IndexedHeap.hpp"
+#include "ObjectPool.hpp"
+#include "PatternDatabase.hpp"
+#include "SearchStats.hpp"
+#include "SolutionCache.hpp"
+#include "StateTable.hpp"
 
 class Solver
 {
@@ -20,11 +33,55 @@ public:
 
    using wall_time = std::chrono::nanoseconds;
 
+   // estimates used to order the greedy and A* searches: the coordinate
+   // distance of the 0-snake to the exit, its walking distance around the
+   // walls, or the walking distance plus the snake cells on the way
+   enum class HeuristicKind
+   {
+      Taxicab,
+      DistanceField,
+      BlockedDistanceField,
+   };
+
+   // open lists of the greedy and A* searches: a binary heap, or buckets
+   // indexed by the small integer keys the heap compares
+   enum class OpenListKind
+   {
+      Heap,
+      Buckets,
+   };
+
+   // why a search stopped before it was over
+   enum class StopReason
+   {
+      None,
+      TimeLimit,
+      NodeLimit,
+      MemoryLimit,
+   };
+
+   // a snapshot of a running search; the bound is the depth, f-bound or
+   // estimate the solver orders its nodes by, at the node being expanded
+   struct Progress
+   {
+      size_t mExpanded;
+      size_t mFrontierSize;
+      size_t mMemoryBytes;
+      int mBound;
+      wall_time mElapsed;
+   };
+
+   using ProgressCallback = std::function<void(const Progress&)>;
+
    Solver() = delete;
    Solver(const Board& aInitial)
       : mInitialPtr{ std::make_unique<Board>(aInitial) }
+      , mNodeScratch{ aInitial }
+      , mChildScratch{ aInitial }
    {}
 
+   virtual ~Solver() = default;
+
    wall_time GetWallTime() const
    {
       return mWallTime;
@@ -45,39 +102,278 @@ public:
       return mSolved;
    }
 
+   // StopReason::None unless a limit stopped the search
+   StopReason GetStopReason() const
+   {
+      return mStopReason;
+   }
+
+   bool IsLimitReached() const
+   {
+      return mStopReason != StopReason::None;
+   }
+
+   // "none", "time limit", "node limit" or "memory limit"
+   static const char* GetStopReasonName(const StopReason aReason);
+
+   const SearchStats& GetStats() const
+   {
+      return mStats;
+   }
+
+   // nodes at depths that are a multiple of the interval keep a copy of
+   // their board; the boards of all other nodes are rebuilt on demand by
+   // replaying moves from the nearest such ancestor
+   void SetCheckpointInterval(const int aInterval)
+   {
+      mCheckpointInterval = aInterval;
+   }
+
+   // number of threads used by solvers that search in parallel; the
+   // sequential solvers ignore it
+   void SetThreadCount(const int aThreadCount)
+   {
+      mThreadCount = aThreadCount;
+   }
+
+   // solvers that only use an admissible bound ignore it
+   void SetHeuristic(const HeuristicKind aKind)
+   {
+      mHeuristicKind = aKind;
+   }
+
+   void SetOpenList(const OpenListKind aKind)
+   {
+      mOpenListKind = aKind;
+   }
+
+   // solvers guided by a lower bound on the moves left use the table in
+   // place of the exit distance; it must be built for the 0-snake of the
+   // board being solved
+   void SetPatternDatabase(std::shared_ptr<const PatternDatabase> aDatabasePtr)
+   {
+      mPatternDatabasePtr = std::move(aDatabasePtr);
+   }
+
+   // limits after which the search stops as if cancelled, and the stop
+   // reason is set; zero for no limit. time is counted from the start of
+   // Exec, nodes are expanded nodes and memory is the estimate of
+   // MemoryBytes. the clock and the memory are only looked at every
+   // LimitCheckInterval expansions
+   void SetTimeLimit(const wall_time aLimit)
+   {
+      mTimeLimit = aLimit;
+   }
+
+   void SetNodeLimit(const size_t aLimit)
+   {
+      mNodeLimit = aLimit;
+   }
+
+   void SetMemoryLimit(const size_t aBytes)
+   {
+      mMemoryLimit = aBytes;
+   }
+
+   // called on the searching thread about every aInterval expansions
+   void SetProgressCallback(ProgressCallback aCallback, const size_t aInterval)
+   {
+      mProgressCallback = std::move(aCallback);
+      mProgressInterval = std::max<size_t>(1, aInterval);
+   }
+
+   // Exec looks the board up in the cache before searching, and stores the
+   // solution it finds there
+   void SetSolutionCache(std::shared_ptr<SolutionCache> aCachePtr)
+   {
+      mSolutionCachePtr = std::move(aCachePtr);
+   }
+
+   // the cached solution Exec returned, or nullptr if it searched
+   const SolutionCache::Entry* GetCacheHit() const
+   {
+      return mFromCache ? &mCacheHit : nullptr;
+   }
+
+   // whether a solution found is a shortest one
+   virtual bool IsOptimal() const
+   {
+      return false;
+   }
+
+   // approximate bytes held by the search: boards, nodes, state tables and
+   // open lists
+   virtual size_t MemoryBytes() const;
+
+   // asks a running search to stop at its next opportunity; safe to call
+   // from another thread, and a search that stops early reports no solution
+   virtual void Cancel()
+   {
+      mCancelled.store(true, std::memory_order_relaxed);
+   }
+
+   bool IsCancelled() const
+   {
+      return mCancelled.load(std::memory_order_relaxed);
+   }
+
    void Exec();
    void PrintToStream(std::ostream& aOut) const;
 
+   // the solution and the search statistics as one JSON object
+   void PrintJson(std::ostream& aOut) const;
+
    virtual void Solve() = 0;
+   virtual const char* GetName() const = 0;
+
+   // admissible estimate of the moves still needed: some end of the 0-snake
+   // has to walk to the exit, and an end moves one cell per move
+   static int ExitLowerBound(const Board& aBoard);
 
 protected:
    
+   // nodes and their boards live in the solver's arena, which releases
+   // the whole search tree at once; only checkpoint nodes own a board
    class SearchNode
    {
    public:
-      SearchNode(SearchNode* aParentPtr, const Board::Move& aMove, const Board& aBoard)
+      SearchNode(SearchNode* aParentPtr, const Board::Move& aMove, Board* aBoardPtr)
          : mParentPtr{ aParentPtr }
-         , mParentMove{ aMove }
-         , mBoardPtr{ std::make_unique<Board>(aBoard) }
+         , mBoardPtr{ aBoardPtr }
          , mDepth{ mParentPtr ? mParentPtr->mDepth + 1 : 0 }
+         , mParentMove{ aMove.Pack() }
       {}
 
-      virtual ~SearchNode() = default;
+      // for nodes whose parent may be updated concurrently by another thread
+      SearchNode(SearchNode* aParentPtr, const Board::Move& aMove, Board* aBoardPtr, const int aDepth)
+         : mParentPtr{ aParentPtr }
+         , mBoardPtr{ aBoardPtr }
+         , mDepth{ aDepth }
+         , mParentMove{ aMove.Pack() }
+      {}
+
+      Board::Move GetParentMove() const
+      {
+         return Board::Move::Unpack(mParentMove);
+      }
+
+      // moves an unexpanded node under a parent that reaches it sooner
+      void Reparent(SearchNode* aParentPtr, const Board::Move& aMove)
+      {
+         mParentPtr = aParentPtr;
+         mDepth = aParentPtr->mDepth + 1;
+         mParentMove = aMove.Pack();
+      }
 
       SearchNode* mParentPtr;
-      Board::Move mParentMove;
-      std::unique_ptr<Board> mBoardPtr;
+      Board* mBoardPtr;
       int mDepth;
-      std::unordered_map<Board::Move, std::unique_ptr<SearchNode>> mChildren;
+      std::uint16_t mParentMove;
    };
 
+   Board* NewBoard(const Board& aBoard)
+   {
+      return mBoards.New(aBoard, Board::allocator_type{ &mArena });
+   }
+
+   // the returned board is only valid until the next call
+   const Board& GetNodeBoard(const SearchNode* aNodePtr);
+
+   // applies aMove to a scratch copy of aParentBoard, which is only valid
+   // until the next call
+   const Board& MakeChildBoard(const Board& aParentBoard, const Board::Move& aMove);
+
+   // keeps a copy of aBoard in the arena if aDepth is a checkpoint depth
+   Board* CheckpointBoard(const Board& aBoard, const int aDepth)
+   {
+      return aDepth % mCheckpointInterval == 0 ? NewBoard(aBoard) : nullptr;
+   }
+
+   void TraceSolution(const SearchNode* aSolutionPtr);
+
+   static constexpr size_t LimitCheckInterval = 256;
+
+   // called once per expansion, with the expanded count so far; returns
+   // true, having cancelled the search, once a limit is reached. reports
+   // progress when it is due. only one thread of a search may call it
+   bool CheckLimits(const size_t aExpanded, const int aBound, const size_t aFrontierSize)
+   {
+      return (mNodeLimit > 0 && aExpanded >= mNodeLimit) || aExpanded >= mNextCheck
+         ? CheckLimitsNow(aExpanded, aBound, aFrontierSize)
+         : false;
+   }
+
+   // whether the estimate the A* searches order nodes by is admissible:
+   // the pattern database distance or the walking distance to the exit
+   bool IsEstimateAdmissible() const
+   {
+      return mPatternDatabasePtr || mHeuristicKind == HeuristicKind::DistanceField;
+   }
+
+   // ExitLowerBound, plus for HeuristicKind::BlockedDistanceField the
+   // snake cells on a shortest corridor from the nearer end to the exit
+   int DistanceFieldHeuristic(const Board& aBoard) const;
+
+   // the pattern database distance of the 0-snake if there is a table,
+   // which is never below ExitLowerBound, and ExitLowerBound otherwise
+   int LowerBound(const Board& aBoard) const
+   {
+      return mPatternDatabasePtr ? mPatternDatabasePtr->Distance(aBoard.GetSnake(0)) : ExitLowerBound(aBoard);
+   }
+
+   // whether aLowerBound, as given by LowerBound, says the 0-snake cannot
+   // reach the exit from the board at all
+   bool IsUnreachable(const int aLowerBound) const
+   {
+      return aLowerBound >= (mPatternDatabasePtr ? PatternDatabase::Unreachable : BoardLayout::Unreachable);
+   }
+
+   // releases every board and node allocated so far; node pools of
+   // subclasses must be cleared first
+   void ClearArena()
+   {
+      mBoards.Clear();
+      mArena.release();
+   }
+
+   std::pmr::monotonic_buffer_resource mArena{ 1 << 16 };
+   ObjectPool<Board> mBoards{ &mArena };
+
    std::unique_ptr<Board> mInitialPtr;
    std::list<Board::Move> mMoves;
    std::unique_ptr<Board> mSolvedPtr;
    bool mSolved = false;
+   int mThreadCount = 1;
+   HeuristicKind mHeuristicKind = HeuristicKind::Taxicab;
+   OpenListKind mOpenListKind = OpenListKind::Heap;
+   SearchStats mStats;
+   std::shared_ptr<const PatternDatabase> mPatternDatabasePtr;
+   StopReason mStopReason = StopReason::None;
 
 private:
+   bool CheckLimitsNow(const size_t aExpanded, const int aBound, const size_t aFrontierSize);
+
+   // takes the solution of aKey from the cache if it solves the board
+   bool ReplayCached(const SolutionCache::Key& aKey);
+
+   wall_time mTimeLimit{ 0 };
+   size_t mNodeLimit = 0;
+   size_t mMemoryLimit = 0;
+   ProgressCallback mProgressCallback;
+   size_t mProgressInterval = 0;
+   size_t mNextCheck = 0;
+   size_t mNextProgress = 0;
+   std::chrono::steady_clock::time_point mStart;
+   std::shared_ptr<SolutionCache> mSolutionCachePtr;
+   SolutionCache::Entry mCacheHit;
+   bool mFromCache = false;
+
    wall_time mWallTime;
+   std::atomic<bool> mCancelled{ false };
+   int mCheckpointInterval = 1;
+   Board mNodeScratch;
+   Board mChildScratch;
+   std::vector<std::uint16_t> mReplayMoves;
 };
 
 class BreadthFirstTreeSearchSolver : public Solver
@@ -86,16 +382,22 @@ public:
    BreadthFirstTreeSearchSolver() = delete;
    BreadthFirstTreeSearchSolver(const Board& aInitial)
       : Solver{ aInitial }
+      , mSeen{ aInitial.GetStateBytes() }
    {}
 
    virtual ~BreadthFirstTreeSearchSolver() = default;
 
    void Solve() override;
+   const char* GetName() const override { return "bfts"; }
+   bool IsOptimal() const override { return true; }
+   size_t MemoryBytes() const override;
 
 private:
-   std::unique_ptr<SearchNode> mInitialNodePtr;
-   std::list<SearchNode*> mFrontier;
-   std::unordered_set<Board> mExplored;
+   ObjectPool<SearchNode> mNodes{ &mArena };
+   std::deque<SearchNode*> mFrontier;
+
+   // every state generated so far, queued or expanded
+   StateTable mSeen;
 };
 
 class IterativeDeepeningDepthFirstTreeSearchSolver : public Solver
@@ -104,18 +406,101 @@ public:
    IterativeDeepeningDepthFirstTreeSearchSolver() = delete;
    IterativeDeepeningDepthFirstTreeSearchSolver(const Board& aInitial)
       : Solver{ aInitial }
+      , mBoard{ aInitial }
+      , mExplored{ aInitial.GetStateBytes() }
    {}
 
    virtual ~IterativeDeepeningDepthFirstTreeSearchSolver() = default;
 
    void Solve() override;
+   const char* GetName() const override { return "iddfts"; }
+   size_t MemoryBytes() const override;
    
 private:
-   SearchNode* SolveToDepth(const int aMaxDepth);
+   // a node on the current path; its untried moves are
+   // mCandidates[mFirstMove, mNextMove), taken from the back
+   struct Frame
+   {
+      size_t mFirstMove;
+      size_t mNextMove;
+
+      // the move that led here and the cell it vacated
+      Board::Move mMove;
+      int mVacated;
+   };
+
+   // walks the tree in place on mBoard; returns true with the solution's
+   // path in mPath
+   bool SolveToDepth(const int aMaxDepth);
+
+   // adds a frame for the node mBoard is at, with its moves as candidates
+   void PushFrame(const Board::Move& aMove, const int aVacated);
+
+   Board mBoard;
+   std::vector<Frame> mPath;
+   std::vector<Board::Move> mCandidates;
+   StateTable mExplored;
+
+   // whether the last iteration left any node unexpanded at its depth
+   // limit; if not, deeper iterations cannot find anything new
+   bool mCutOff = false;
+};
+
+// depth-first search bounded by f = g + h, where each iteration raises the
+// bound to the smallest f that exceeded it; only the current path and a
+// fixed-size transposition table are kept, so memory does not grow with
+// the depth of the search
+class IterativeDeepeningAStarSolver : public Solver
+{
+public:
+   IterativeDeepeningAStarSolver() = delete;
+   IterativeDeepeningAStarSolver(const Board& aInitial)
+      : Solver{ aInitial }
+      , mTable(TableSize)
+      , mBoard{ aInitial }
+   {}
+
+   virtual ~IterativeDeepeningAStarSolver() = default;
+
+   void Solve() override;
+   const char* GetName() const override { return "idastar"; }
+   bool IsOptimal() const override { return true; }
+   size_t MemoryBytes() const override;
+
+private:
+   static constexpr size_t TableSize = size_t{ 1 } << 21;
+   static constexpr int Found = -1;
+
+   // the shallowest depth a state was reached at in the iteration with
+   // the given bound; entries of earlier iterations count as empty
+   struct TableEntry
+   {
+      std::uint64_t mKey = 0;
+      std::uint64_t mCheck = 0;
+      int mBound = -1;
+      int mDepth = 0;
+   };
+
+   // returns Found, or the smallest f that exceeded the bound below
+   // mBoard, which is at aDepth; on Found mBoard is left at the solution
+   int Search(const int aDepth, const int aBound);
+
+   // returns false if the state was already searched at no greater depth
+   // in this iteration; an entry nearer the root covers a larger subtree,
+   // so it is only replaced by one from a later iteration or nearer still
+   bool Probe(const Board& aBoard, const int aDepth, const int aBound);
 
-   std::unique_ptr<SearchNode> mInitialNodePtr;
-   std::stack<SearchNode*> mFrontier;
-   std::unordered_set<Board> mExplored;
+   // second hash of the packed state that confirms a key match; the key
+   // alone is the same for snakes covering the same cells in another order
+   static std::uint64_t StateCheck(const Board& aBoard);
+
+   std::vector<TableEntry> mTable;
+
+   // the search walks mBoard in place; the moves still to try from every
+   // node on the path share one stack
+   Board mBoard;
+   std::vector<Board::Move> mPathMoves;
+   std::vector<Board::Move> mCandidates;
 };
 
 class GreedyBestFirstGraphSearchSolver : public Solver
@@ -124,41 +509,62 @@ public:
    GreedyBestFirstGraphSearchSolver() = delete;
    GreedyBestFirstGraphSearchSolver(const Board& aInitial)
       : Solver{ aInitial }
+      , mStates{ aInitial.GetStateBytes() }
    {}
 
    virtual ~GreedyBestFirstGraphSearchSolver() = default;
 
    void Solve() override;
+   const char* GetName() const override { return "gbfgs"; }
+   size_t MemoryBytes() const override;
 
 protected:
    class SearchNode : public Solver::SearchNode
    {
    public:
-      SearchNode(SearchNode* aParentPtr, const Board::Move& aMove, const Board& aBoard)
-         : Solver::SearchNode{ aParentPtr, aMove, aBoard }
-         , mHeuristicScore{ Heuristic(this) }
+      SearchNode(SearchNode* aParentPtr, const Board::Move& aMove, Board* aBoardPtr, const int aHeuristicScore)
+         : Solver::SearchNode{ aParentPtr, aMove, aBoardPtr }
+         , mHeuristicScore{ aHeuristicScore }
       {}
 
-      virtual ~SearchNode() = default;
-
       int mHeuristicScore;
+      int mHeapIdx = -1;
    };
 
-   static int Heuristic(const SearchNode* aSearchNodePtr);
+   static int Heuristic(const Board& aBoard);
 
+   int Estimate(const Board& aBoard) const
+   {
+      return mHeuristicKind == HeuristicKind::Taxicab ? Heuristic(aBoard) : DistanceFieldHeuristic(aBoard);
+   }
+
+   // ties go to the node reached in fewer moves
    struct Compare
    {
       bool operator()(const SearchNode* aLhs, const SearchNode* aRhs) const
       {
-         return aLhs->mHeuristicScore > aRhs->mHeuristicScore;
+         return aLhs->mHeuristicScore > aRhs->mHeuristicScore
+            || (aLhs->mHeuristicScore == aRhs->mHeuristicScore && aLhs->mDepth > aRhs->mDepth);
       };
    };
 
+   // same order as Compare
+   struct Keys
+   {
+      static int Primary(const SearchNode* aNodePtr) { return aNodePtr->mHeuristicScore; }
+      static int Secondary(const SearchNode* aNodePtr) { return aNodePtr->mDepth; }
+   };
+
 private:
+   template <typename OpenList>
+   void Search(OpenList& aFrontier);
+
+   ObjectPool<SearchNode> mNodes{ &mArena };
 
-   std::unique_ptr<SearchNode> mInitialNodePtr;
-   std::unordered_set<Board> mExplored;
-   std::priority_queue<SearchNode*, std::vector<SearchNode*>, Compare> mFrontier;
+   // maps every generated state to its node, open or closed
+   StateTable mStates;
+   IndexedHeap<SearchNode, Compare> mFrontier;
+   BucketQueue<SearchNode, Keys> mBucketFrontier;
 };
 
 class AStarSolver : public Solver
@@ -167,41 +573,218 @@ public:
    AStarSolver() = delete;
    AStarSolver(const Board& aInitial)
       : Solver{ aInitial }
+      , mStates{ aInitial.GetStateBytes() }
    {}
 
    virtual ~AStarSolver() = default;
 
    void Solve() override;
+   const char* GetName() const override { return "astar"; }
+   bool IsOptimal() const override { return IsEstimateAdmissible(); }
+   size_t MemoryBytes() const override;
+
+   static int Heuristic(const Board& aBoard);
+
+   // also sets aSweepDepth to the number of diagonals in front of the exit
+   // that were looked at
+   static int Heuristic(const Board& aBoard, int& aSweepDepth);
 
 protected:
    class SearchNode : public Solver::SearchNode
    {
    public:
-      SearchNode(SearchNode* aParentPtr, const Board::Move& aMove, const Board& aBoard)
-         : Solver::SearchNode{ aParentPtr, aMove, aBoard }
-         , mHeuristicScore{ Heuristic(this) }
+      SearchNode(SearchNode* aParentPtr, const Board::Move& aMove, Board* aBoardPtr, const int aHeuristicScore,
+         const int aSweepDepth)
+         : Solver::SearchNode{ aParentPtr, aMove, aBoardPtr }
+         , mSweepDepth{ static_cast<std::uint16_t>(aSweepDepth) }
+         , mHeuristicScore{ aHeuristicScore }
       {}
 
-      virtual ~SearchNode() = default;
-
+      // fits in the padding at the end of the base node
+      std::uint16_t mSweepDepth;
       int mHeuristicScore;
+      int mHeapIdx = -1;
    };
 
-   static int Heuristic(const SearchNode* aSearchNodePtr);
+   // the selected heuristic, unless a pattern database is set; its
+   // distances are admissible, so the solution found is then a shortest one.
+   // aSweepDepth is only set by the taxicab heuristic, and is 0 otherwise
+   int Estimate(const Board& aBoard, int& aSweepDepth) const
+   {
+      aSweepDepth = 0;
+      if (mPatternDatabasePtr)
+      {
+         return LowerBound(aBoard);
+      }
+      return mHeuristicKind == HeuristicKind::Taxicab ? Heuristic(aBoard, aSweepDepth) : DistanceFieldHeuristic(aBoard);
+   }
 
+   // Estimate of aChild, reached from the node aParentPtr with board
+   // aParent by aMove; the parent's score is reused when the move changes
+   // nothing the estimate looks at
+   int ChildEstimate(const SearchNode* aParentPtr, const Board& aParent, const Board& aChild, const Board::Move& aMove,
+      int& aSweepDepth) const;
+
+   // ties go to the node closer to the goal
    struct Compare
    {
       bool operator()(const SearchNode* aLhs, const SearchNode* aRhs) const
       {
-         return aLhs->mHeuristicScore + aLhs->mDepth > aRhs->mHeuristicScore + aRhs->mDepth;
+         const int lhsScore = aLhs->mHeuristicScore + aLhs->mDepth;
+         const int rhsScore = aRhs->mHeuristicScore + aRhs->mDepth;
+         return lhsScore > rhsScore
+            || (lhsScore == rhsScore && aLhs->mHeuristicScore > aRhs->mHeuristicScore);
       }
    };
 
+   // same order as Compare
+   struct Keys
+   {
+      static int Primary(const SearchNode* aNodePtr) { return aNodePtr->mHeuristicScore + aNodePtr->mDepth; }
+      static int Secondary(const SearchNode* aNodePtr) { return aNodePtr->mHeuristicScore; }
+   };
+
 private:
+   template <typename OpenList>
+   void Search(OpenList& aFrontier);
+
+   // true if Heuristic looked at aCell when it scored aBoard
+   static bool IsSeenByHeuristic(const Board& aBoard, const int aCell, const int aSweepDepth);
+
+   ObjectPool<SearchNode> mNodes{ &mArena };
+
+   // maps every generated state to its node, open or closed
+   StateTable mStates;
+   IndexedHeap<SearchNode, Compare> mFrontier;
+   BucketQueue<SearchNode, Keys> mBucketFrontier;
+};
+
+// weighted A*, which orders nodes by g + w * h: the larger the weight, the
+// sooner a solution turns up and the longer it may be. in anytime mode the
+// search goes on after a solution with ever smaller weights down to 1,
+// keeping its open and closed nodes from round to round (ARA*), until a
+// round at weight 1 is over or the deadline passes. the best solution found
+// so far is kept when the search stops early, cancelled or not
+class AnytimeWeightedAStarSolver : public Solver
+{
+public:
+   AnytimeWeightedAStarSolver() = delete;
+   AnytimeWeightedAStarSolver(const Board& aInitial)
+      : Solver{ aInitial }
+      , mStates{ aInitial.GetStateBytes() }
+   {}
+
+   virtual ~AnytimeWeightedAStarSolver() = default;
+
+   void Solve() override;
+   const char* GetName() const override { return "wastar"; }
+
+   // only once a round at weight 1 is over
+   bool IsOptimal() const override { return mOptimal; }
+   size_t MemoryBytes() const override;
+
+   // weight of the first round; weights below 1 are taken as 1
+   void SetWeight(const double aWeight)
+   {
+      mWeight = aWeight < 1.0 ? 1.0 : aWeight;
+   }
+
+   void SetAnytime(const bool aAnytime)
+   {
+      mAnytime = aAnytime;
+   }
+
+   // time after which the search stops, counted from its start; zero for
+   // no deadline
+   void SetDeadline(const wall_time aDeadline)
+   {
+      mDeadline = aDeadline;
+   }
+
+private:
+   // weights are fixed point, in steps of 1 / WeightScale
+   static constexpr int WeightScale = 100;
+
+   // weight taken off after every round
+   static constexpr int WeightStep = 50;
+
+   // expansions between looks at the clock
+   static constexpr int DeadlineCheckInterval = 256;
+
+   class SearchNode : public Solver::SearchNode
+   {
+   public:
+      SearchNode(SearchNode* aParentPtr, const Board::Move& aMove, Board* aBoardPtr, const int aHeuristicScore,
+         const int aLowerBound)
+         : Solver::SearchNode{ aParentPtr, aMove, aBoardPtr }
+         , mHeuristicScore{ aHeuristicScore }
+         , mLowerBound{ aLowerBound }
+      {}
+
+      int mHeuristicScore;
+      int mLowerBound;
+      int mPriority = 0;
+      int mHeapIdx = -1;
+
+      // last round the node was expanded in, and whether its path has
+      // improved since then
+      int mClosedRound = -1;
+      bool mInconsistent = false;
+   };
+
+   // ties go to the node closer to the goal
+   struct Compare
+   {
+      bool operator()(const SearchNode* aLhs, const SearchNode* aRhs) const
+      {
+         return aLhs->mPriority > aRhs->mPriority
+            || (aLhs->mPriority == aRhs->mPriority && aLhs->mHeuristicScore > aRhs->mHeuristicScore);
+      }
+   };
+
+   // same as AStarSolver::Estimate
+   int Estimate(const Board& aBoard) const
+   {
+      if (mPatternDatabasePtr)
+      {
+         return LowerBound(aBoard);
+      }
+      return mHeuristicKind == HeuristicKind::Taxicab ? AStarSolver::Heuristic(aBoard) : DistanceFieldHeuristic(aBoard);
+   }
+
+   void SetPriority(SearchNode* aNodePtr) const
+   {
+      aNodePtr->mPriority = aNodePtr->mDepth * WeightScale + mRoundWeight * aNodePtr->mHeuristicScore;
+   }
+
+   // expands nodes until none left open can lead to a better solution at
+   // the weight of this round; returns false if the search was stopped
+   bool ImprovePath();
+
+   // queues the open and inconsistent nodes again under the next weight
+   void NextRound();
+
+   bool IsPastDeadline() const;
+
+   double mWeight = 2.0;
+   bool mAnytime = false;
+   wall_time mDeadline{ 0 };
+   std::chrono::steady_clock::time_point mStart;
+
+   int mRound = 0;
+   int mRoundWeight = WeightScale;
+
+   ObjectPool<SearchNode> mNodes{ &mArena };
+
+   // maps every generated state to its node; solutions are never queued
+   StateTable mStates;
+   IndexedHeap<SearchNode, Compare> mFrontier;
+   std::vector<SearchNode*> mInconsistentNodes;
 
-   std::unique_ptr<SearchNode> mInitialNodePtr;
-   std::unordered_set<Board> mExplored;
-   std::priority_queue<SearchNode*, std::vector<SearchNode*>, Compare> mFrontier;
+   // nodes are pruned by an admissible bound against the best solution
+   SearchNode* mBestPtr = nullptr;
+   int mBestCost = INT_MAX;
+   bool mOptimal = false;
 };
 
 #endif
@@ -0,0 +1,148 @@
+
+#include <algorithm>
+#include <cstring>
+
+#include "StateTable.hpp"
+
+namespace
+{
+const size_t INITIAL_CAPACITY = 1024;
+}
+
+StateTable::StateTable(const size_t aStateBytes)
+   : mStateBytes{ aStateBytes }
+   , mSlotWords{ StateWord + (aStateBytes + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t) }
+{
+   Rehash(INITIAL_CAPACITY);
+}
+
+bool StateTable::Insert(const Board& aBoard)
+{
+   bool inserted;
+   FindOrInsert(aBoard, inserted);
+   return inserted;
+}
+
+bool StateTable::Contains(const Board& aBoard) const
+{
+   const size_t slot = FindSlot(SlotHash(aBoard), aBoard.GetStateData());
+   return mSlots[slot * mSlotWords + HashWord] != 0;
+}
+
+size_t StateTable::FindOrInsert(const Board& aBoard, bool& aInserted)
+{
+   if (mSize + 1 > mCapacity * MaxLoadFactor)
+   {
+      Rehash(mCapacity * 2);
+   }
+
+   const std::uint64_t hash = SlotHash(aBoard);
+   const size_t slot = FindSlot(hash, aBoard.GetStateData());
+   std::uint64_t* slotPtr = &mSlots[slot * mSlotWords];
+
+   aInserted = slotPtr[HashWord] == 0;
+   if (aInserted)
+   {
+      slotPtr[HashWord] = hash;
+      slotPtr[ValueWord] = 0;
+      std::memcpy(slotPtr + StateWord, aBoard.GetStateData(), mStateBytes);
+      ++mSize;
+   }
+   return slot;
+}
+
+void* StateTable::Find(const Board& aBoard) const
+{
+   const size_t slot = FindSlot(SlotHash(aBoard), aBoard.GetStateData());
+   return mSlots[slot * mSlotWords + HashWord] != 0 ? GetValue(slot) : nullptr;
+}
+
+void StateTable::Reserve(const size_t aCount)
+{
+   size_t capacity = mCapacity;
+   while (aCount > capacity * MaxLoadFactor)
+   {
+      capacity *= 2;
+   }
+   if (capacity != mCapacity)
+   {
+      Rehash(capacity);
+   }
+}
+
+void StateTable::Clear()
+{
+   std::fill(mSlots.begin(), mSlots.end(), 0);
+   mSize = 0;
+}
+
+size_t StateTable::FindSlot(const std::uint64_t aHash, const void* aState) const
+{
+   const size_t mask = mCapacity - 1;
+   size_t slot = static_cast<size_t>(aHash) & mask;
+   while (true)
+   {
+      const std::uint64_t* slotPtr = &mSlots[slot * mSlotWords];
+      if (slotPtr[HashWord] == 0
+         || (slotPtr[HashWord] == aHash && std::memcmp(slotPtr + StateWord, aState, mStateBytes) == 0))
+      {
+         return slot;
+      }
+      slot = (slot + 1) & mask;
+   }
+}
+
+void StateTable::Rehash(const size_t aCapacity)
+{
+   std::vector<std::uint64_t> oldSlots(aCapacity * mSlotWords, 0);
+   oldSlots.swap(mSlots);
+   const size_t oldCapacity = mCapacity;
+   mCapacity = aCapacity;
+
+   const size_t mask = mCapacity - 1;
+   for (size_t i = 0; i < oldCapacity; ++i)
+   {
+      const std::uint64_t* oldPtr = &oldSlots[i * mSlotWords];
+      if (oldPtr[HashWord] == 0)
+      {
+         continue;
+      }
+
+      // states are unique, so only the hash word needs probing
+      size_t slot = static_cast<size_t>(oldPtr[HashWord]) & mask;
+      while (mSlots[slot * mSlotWords + HashWord] != 0)
+      {
+         slot = (slot + 1) & mask;
+      }
+      std::memcpy(&mSlots[slot * mSlotWords], oldPtr, mSlotWords * sizeof(std::uint64_t));
+   }
+}
+
+ShardedStateTable::ShardedStateTable(const size_t aStateBytes, const int aShardBits)
+   : mShardBits{ aShardBits }
+{
+   mShards.reserve(size_t{ 1 } << aShardBits);
+   for (size_t i = 0; i < (size_t{ 1 } << aShardBits); ++i)
+   {
+      mShards.push_back(std::make_unique<Shard>(aStateBytes));
+   }
+}
+
+bool ShardedStateTable::Insert(const Board& aBoard)
+{
+   const std::uint64_t hash = aBoard.Hash();
+   Shard& shard = *mShards[mShardBits ? hash >> (64 - mShardBits) : 0];
+   std::lock_guard<std::mutex> lock{ shard.mMutex };
+   return shard.mTable.Insert(aBoard);
+}
+
+size_t ShardedStateTable::Size() const
+{
+   size_t size = 0;
+   for (const auto& shardPtr : mShards)
+   {
+      std::lock_guard<std::mutex> lock{ shardPtr->mMutex };
+      size += shardPtr->mTable.Size();
+   }
+   return size;
+}
@@ -0,0 +1,110 @@
+
+#ifndef STATETABLE_HPP
+#define STATETABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Board.hpp"
+
+// flat open-addressing table of board states; each slot holds the board's
+// cached hash, a pointer-sized value and the packed snake state, and
+// collisions are resolved by linear probing
+class StateTable
+{
+public:
+   static constexpr double MaxLoadFactor = 0.7;
+
+   StateTable() = delete;
+   explicit StateTable(const size_t aStateBytes);
+
+   // returns true if the state was not in the table yet
+   bool Insert(const Board& aBoard);
+   bool Contains(const Board& aBoard) const;
+
+   // finds the state, inserting it with a null value if it is absent; the
+   // returned slot is only valid until the next insertion
+   size_t FindOrInsert(const Board& aBoard, bool& aInserted);
+
+   void* GetValue(const size_t aSlot) const
+   {
+      void* value;
+      std::memcpy(&value, &mSlots[aSlot * mSlotWords + ValueWord], sizeof(value));
+      return value;
+   }
+
+   void SetValue(const size_t aSlot, void* aValue)
+   {
+      std::memcpy(&mSlots[aSlot * mSlotWords + ValueWord], &aValue, sizeof(aValue));
+   }
+
+   // the value stored with the state, or nullptr if it is absent
+   void* Find(const Board& aBoard) const;
+
+   // makes room for aCount states without growing
+   void Reserve(const size_t aCount);
+   void Clear();
+
+   size_t Size() const { return mSize; }
+   size_t Capacity() const { return mCapacity; }
+   double LoadFactor() const { return mCapacity ? static_cast<double>(mSize) / mCapacity : 0.0; }
+   size_t MemoryBytes() const { return mSlots.capacity() * sizeof(std::uint64_t); }
+
+private:
+   // slots with a zero hash word are empty
+   static std::uint64_t SlotHash(const Board& aBoard)
+   {
+      const std::uint64_t hash = aBoard.Hash();
+      return hash ? hash : 1;
+   }
+
+   // returns the slot holding the state, or the empty slot where it belongs
+   size_t FindSlot(const std::uint64_t aHash, const void* aState) const;
+   void Rehash(const size_t aCapacity);
+
+   static constexpr size_t HashWord = 0;
+   static constexpr size_t ValueWord = 1;
+   static constexpr size_t StateWord = 2;
+   static_assert(sizeof(void*) <= sizeof(std::uint64_t), "values must fit in one word");
+
+   size_t mStateBytes;
+   size_t mSlotWords;
+   size_t mCapacity = 0;
+   size_t mSize = 0;
+   std::vector<std::uint64_t> mSlots;
+};
+
+// StateTable split into independently locked shards so that several
+// threads can insert at once; shards are picked by the high bits of the
+// hash, which the shard tables themselves do not probe on
+class ShardedStateTable
+{
+public:
+   ShardedStateTable() = delete;
+   ShardedStateTable(const size_t aStateBytes, const int aShardBits);
+
+   // returns true if the state was not in the table yet; thread safe
+   bool Insert(const Board& aBoard);
+
+   size_t Size() const;
+
+private:
+   struct Shard
+   {
+      explicit Shard(const size_t aStateBytes)
+         : mTable{ aStateBytes }
+      {}
+
+      std::mutex mMutex;
+      StateTable mTable;
+   };
+
+   int mShardBits;
+   std::vector<std::unique_ptr<Shard>> mShards;
+};
+
+#endif
@@ -3,21 +3,129 @@
 
 #include "wriggle.hpp"
 
+namespace
+{
+// ReadNumber, reporting a value that is not a number in [aMin, aMax] and
+// clearing aValid
+template <typename T>
+void ParseNumber(const std::string& aName, const std::string& aValue, const T aMin, const T aMax, T& aNumber,
+   bool& aValid)
+{
+   if (!ReadNumber(aValue, aMin, aMax, aNumber))
+   {
+      std::cout << "wriggle: invalid value '" << aValue << "' for --" << aName << std::endl;
+      aValid = false;
+   }
+}
+
+// a time in milliseconds, bounded so that it still fits in nanoseconds
+void ParseMilliseconds(const std::string& aName, const std::string& aValue, std::chrono::milliseconds& aTime,
+   bool& aValid)
+{
+   std::int64_t count = aTime.count();
+   ParseNumber<std::int64_t>(aName, aValue, 0, INT64_MAX / 1000000, count, aValid);
+   aTime = std::chrono::milliseconds{ count };
+}
+
+// returns false for names that are not a heuristic kind
+bool ParseHeuristic(const std::string& aName, Solver::HeuristicKind& aKind)
+{
+   if (aName == "taxicab")
+   {
+      aKind = Solver::HeuristicKind::Taxicab;
+   }
+   else if (aName == "field")
+   {
+      aKind = Solver::HeuristicKind::DistanceField;
+   }
+   else if (aName == "blocked")
+   {
+      aKind = Solver::HeuristicKind::BlockedDistanceField;
+   }
+   else
+   {
+      return false;
+   }
+   return true;
+}
+
+// builds the pattern database for the 0-snake of aInitial, or takes it from
+// aPath if that holds one for the same layout; a built table is saved to a
+// non-empty aPath
+std::shared_ptr<const PatternDatabase> LoadPatternDatabase(const Board& aInitial, const std::string& aPath)
+{
+   const auto start = std::chrono::steady_clock::now();
+   PatternDatabase::Builder builder{ aInitial.GetLayout(), aInitial.GetSnake(0).GetLength() };
+   const bool loaded = !aPath.empty() && builder.FromFile(aPath);
+   std::shared_ptr<const PatternDatabase> databasePtr = builder.Build();
+   const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+   if (!databasePtr)
+   {
+      std::cerr << "wriggle: pattern database too large, not used" << std::endl;
+      return nullptr;
+   }
+
+   std::cerr << "wriggle: pattern database " << (loaded ? "loaded" : "built") << " in " << elapsed.count() << " ms, "
+      << databasePtr->Size() << " entries, " << databasePtr->MemoryBytes() << " bytes" << std::endl;
+   if (!loaded && !aPath.empty() && !databasePtr->Save(aPath))
+   {
+      std::cerr << "wriggle: could not save pattern database to " << aPath << std::endl;
+   }
+   return databasePtr;
+}
+
+// returns nullptr for letters that name no solver
+std::unique_ptr<Solver> MakeSolver(const char aChoice, const Board& aInitial)
+{
+   switch (aChoice)
+   {
+   case 'b':
+      return std::make_unique<BreadthFirstTreeSearchSolver>(aInitial);
+   case 'i':
+      return std::make_unique<IterativeDeepeningDepthFirstTreeSearchSolver>(aInitial);
+   case 'g':
+      return std::make_unique<GreedyBestFirstGraphSearchSolver>(aInitial);
+   case 'a':
+      return std::make_unique<AStarSolver>(aInitial);
+   case 'p':
+      return std::make_unique<ParallelBreadthFirstSearchSolver>(aInitial);
+   case 'h':
+      return std::make_unique<HashDistributedAStarSolver>(aInitial);
+   case 'd':
+      return std::make_unique<IterativeDeepeningAStarSolver>(aInitial);
+   case 'w':
+      return std::make_unique<AnytimeWeightedAStarSolver>(aInitial);
+   default:
+      return nullptr;
+   }
+}
+}
+
 int main(int argc, char* argv[])
 {
    if (argc < 2)
    {
-      std::cout << "usage: wriggle <filename> {[b]fts|[i]ddfts|[g]bfgs|[a]star}" << std::endl;
+      std::cout << "usage: wriggle {<filename>|--batch=<dir|glob|manifest>} {[b]fts|[i]ddfts|[g]bfgs|[a]star|[p]bfs|[h]dastar|i[d]astar|[w]astar|p[o]rtfolio} [--checkpoint=<n>] [--threads=<n>] [--portfolio=<solvers>] [--pdb[=<file>]] [--heuristic=taxicab|field|blocked] [--open=heap|buckets] [--weight=<w>] [--anytime] [--deadline=<ms>] [--jobs=<n>] [--timeout=<ms>] [--stats=text|json] [--time-limit=<ms>] [--node-limit=<n>] [--memory-limit=<MB>] [--progress=<n>] [--cache=<file>]" << std::endl;
       return 0;
    }
+
+   // batches run unattended, so they never prompt
+   std::string batchSpec;
+   const bool batch = ParseOption(argv[1], "batch", batchSpec);
    
    std::string solverChoice = "";
-   if (argc < 3)
+   if (argc < 3 && batch)
+   {
+      std::cout << "wriggle: a batch needs a solver, exiting" << std::endl;
+      return 1;
+   }
+   else if (argc < 3)
    {
       bool valid = false;
       do
       {
-         std::cout << "wriggle: choose solver ([b]fts|[i]ddfts|[g]bfgs|[a]star): " << std::flush;
+         std::cout << "wriggle: choose solver ([b]fts|[i]ddfts|[g]bfgs|[a]star|[p]bfs|[h]dastar|i[d]astar|[w]astar|p[o]rtfolio): " << std::flush;
          std::cin >> solverChoice;
          if (solverChoice.empty())
          {
@@ -27,7 +135,12 @@ int main(int argc, char* argv[])
          valid = solverChoice[0] == 'b' ||
             solverChoice[0] == 'i' ||
             solverChoice[0] == 'g' ||
-            solverChoice[0] == 'a';
+            solverChoice[0] == 'a' ||
+            solverChoice[0] == 'p' ||
+            solverChoice[0] == 'h' ||
+            solverChoice[0] == 'd' ||
+            solverChoice[0] == 'w' ||
+            solverChoice[0] == 'o';
 
       } while (!valid);
    }
@@ -36,38 +149,305 @@ int main(int argc, char* argv[])
       solverChoice = argv[2];
    }
 
+   int checkpointInterval = 1;
+   int threadCount = std::max(1u, std::thread::hardware_concurrency());
+   std::string portfolio = "bga";
+   bool usePatternDatabase = false;
+   Solver::HeuristicKind heuristicKind = Solver::HeuristicKind::Taxicab;
+   Solver::OpenListKind openListKind = Solver::OpenListKind::Heap;
+   std::string patternDatabasePath;
+   double weight = 2.0;
+   bool anytime = false;
+   std::chrono::milliseconds deadline{ 0 };
+   int jobCount = threadCount;
+   std::chrono::milliseconds timeout{ 0 };
+   std::string statsFormat;
+   std::chrono::milliseconds timeLimit{ 0 };
+   size_t nodeLimit = 0;
+   size_t memoryLimit = 0;
+   size_t progressInterval = 0;
+   std::string cachePath;
+   bool validOptions = true;
+   for (int i = 3; i < argc; ++i)
+   {
+      std::string value;
+      if (ParseOption(argv[i], "checkpoint", value))
+      {
+         ParseNumber("checkpoint", value, 1, INT_MAX, checkpointInterval, validOptions);
+      }
+      else if (ParseOption(argv[i], "threads", value))
+      {
+         ParseNumber("threads", value, 1, INT_MAX, threadCount, validOptions);
+      }
+      else if (ParseOption(argv[i], "portfolio", value))
+      {
+         portfolio = value;
+      }
+      else if (ParseOption(argv[i], "heuristic", value))
+      {
+         if (!ParseHeuristic(value, heuristicKind))
+         {
+            std::cout << "wriggle: ignoring unknown heuristic " << value << std::endl;
+         }
+      }
+      else if (ParseOption(argv[i], "open", value) && (value == "heap" || value == "buckets"))
+      {
+         openListKind = value == "heap" ? Solver::OpenListKind::Heap : Solver::OpenListKind::Buckets;
+      }
+      else if (ParseOption(argv[i], "weight", value))
+      {
+         ParseNumber("weight", value, 1.0, DBL_MAX, weight, validOptions);
+      }
+      else if (ParseOption(argv[i], "jobs", value))
+      {
+         ParseNumber("jobs", value, 1, INT_MAX, jobCount, validOptions);
+      }
+      else if (ParseOption(argv[i], "timeout", value))
+      {
+         ParseMilliseconds("timeout", value, timeout, validOptions);
+      }
+      else if (ParseOption(argv[i], "stats", value) && (value == "text" || value == "json"))
+      {
+         statsFormat = value;
+      }
+      else if (ParseOption(argv[i], "time-limit", value))
+      {
+         ParseMilliseconds("time-limit", value, timeLimit, validOptions);
+      }
+      else if (ParseOption(argv[i], "node-limit", value))
+      {
+         ParseNumber<size_t>("node-limit", value, 0, SIZE_MAX, nodeLimit, validOptions);
+      }
+      else if (ParseOption(argv[i], "memory-limit", value))
+      {
+         size_t megabytes = 0;
+         ParseNumber<size_t>("memory-limit", value, 0, SIZE_MAX >> 20, megabytes, validOptions);
+         memoryLimit = megabytes << 20;
+      }
+      else if (ParseOption(argv[i], "progress", value))
+      {
+         ParseNumber<size_t>("progress", value, 0, SIZE_MAX, progressInterval, validOptions);
+      }
+      else if (ParseOption(argv[i], "cache", value))
+      {
+         cachePath = value;
+      }
+      else if (std::string{ argv[i] } == "--anytime")
+      {
+         anytime = true;
+      }
+      else if (ParseOption(argv[i], "deadline", value))
+      {
+         ParseMilliseconds("deadline", value, deadline, validOptions);
+      }
+      else if (std::string{ argv[i] } == "--pdb")
+      {
+         usePatternDatabase = true;
+      }
+      else if (ParseOption(argv[i], "pdb", value))
+      {
+         usePatternDatabase = true;
+         patternDatabasePath = value;
+      }
+      else
+      {
+         std::cout << "wriggle: ignoring unknown option " << argv[i] << std::endl;
+      }
+   }
+   if (!validOptions)
+   {
+      std::cout << "wriggle: invalid option values, exiting" << std::endl;
+      return 1;
+   }
+
+   // shared by every job of a batch, and by other processes using the file
+   std::shared_ptr<SolutionCache> cachePtr;
+   if (!cachePath.empty())
+   {
+      try
+      {
+         cachePtr = std::make_shared<SolutionCache>(cachePath);
+      }
+      catch (const std::exception& aError)
+      {
+         std::cerr << "wriggle: " << aError.what() << ", cache not used" << std::endl;
+      }
+   }
+
+   // a puzzle with an optimal cached solution needs no pattern database
+   auto IsCached = [&](const Board& aInitial)
+   {
+      SolutionCache::Entry entry;
+      return cachePtr && cachePtr->Find(SolutionCache::KeyOf(aInitial), entry) && entry.mOptimal;
+   };
+
+   auto Configure = [&](Solver& aSolver, const std::shared_ptr<const PatternDatabase>& aDatabasePtr)
+   {
+      aSolver.SetCheckpointInterval(checkpointInterval);
+      aSolver.SetThreadCount(threadCount);
+      aSolver.SetHeuristic(heuristicKind);
+      aSolver.SetOpenList(openListKind);
+      aSolver.SetPatternDatabase(aDatabasePtr);
+      aSolver.SetTimeLimit(timeLimit);
+      aSolver.SetNodeLimit(nodeLimit);
+      aSolver.SetMemoryLimit(memoryLimit);
+      if (progressInterval > 0)
+      {
+         // one write per line, as portfolio engines report from their own threads
+         const char* name = aSolver.GetName();
+         aSolver.SetProgressCallback([name](const Solver::Progress& aProgress)
+         {
+            std::ostringstream line;
+            line << "wriggle: " << name << " expanded " << aProgress.mExpanded << ", frontier " << aProgress.mFrontierSize
+               << ", bound " << aProgress.mBound << ", " << aProgress.mMemoryBytes << " bytes, "
+               << std::chrono::duration_cast<std::chrono::milliseconds>(aProgress.mElapsed).count() << " ms\n";
+            std::cerr << line.str() << std::flush;
+         }, progressInterval);
+      }
+      if (auto* weightedPtr = dynamic_cast<AnytimeWeightedAStarSolver*>(&aSolver))
+      {
+         weightedPtr->SetWeight(weight);
+         weightedPtr->SetAnytime(anytime);
+         weightedPtr->SetDeadline(deadline);
+      }
+   };
+
+   // returns nullptr if the choice names no solver
+   auto Create = [&](const Board& aInitial, const std::shared_ptr<const PatternDatabase>& aDatabasePtr)
+   {
+      std::unique_ptr<Solver> solver;
+      if (solverChoice[0] == 'o')
+      {
+         std::vector<std::unique_ptr<Solver>> engines;
+         for (const char choice : portfolio)
+         {
+            std::unique_ptr<Solver> engine = MakeSolver(choice, aInitial);
+            if (!engine)
+            {
+               std::cout << "wriggle: ignoring unknown portfolio solver " << choice << std::endl;
+               continue;
+            }
+            Configure(*engine, aDatabasePtr);
+            engines.push_back(std::move(engine));
+         }
+         solver = std::make_unique<PortfolioSolver>(aInitial, std::move(engines));
+      }
+      else
+      {
+         solver = MakeSolver(solverChoice[0], aInitial);
+      }
+
+      // only the solver on top looks in the cache, not portfolio engines
+      if (solver)
+      {
+         Configure(*solver, aDatabasePtr);
+         solver->SetSolutionCache(cachePtr);
+      }
+      return solver;
+   };
+
+   if (batch)
+   {
+      // pattern databases are built for every puzzle and never saved
+      BatchRunner runner{ [&](const Board& aInitial)
+      {
+         std::shared_ptr<const PatternDatabase> databasePtr;
+         if (usePatternDatabase && !IsCached(aInitial))
+         {
+            databasePtr = PatternDatabase::Builder{ aInitial.GetLayout(), aInitial.GetSnake(0).GetLength() }.Build();
+         }
+
+         std::unique_ptr<Solver> solver = Create(aInitial, databasePtr);
+         if (!solver)
+         {
+            throw std::runtime_error("solver not implemented");
+         }
+         return solver;
+      } };
+      runner.SetJobCount(jobCount);
+      runner.SetTimeout(timeout);
+      runner.SetJsonReport(statsFormat == "json");
+
+      std::vector<std::string> paths;
+      try
+      {
+         paths = BatchRunner::FindPuzzles(batchSpec);
+      }
+      catch (const std::exception& aError)
+      {
+         std::cout << "wriggle: " << aError.what() << ", exiting" << std::endl;
+         return 1;
+      }
+      runner.Run(paths, std::cout, std::cerr);
+      return 0;
+   }
+
    std::string filename = argv[1];
-   std::ifstream fin{ filename };
-   
-   Board::Builder builder;
-   builder.FromStream(fin);
-   fin.close();
+   Board initial;
+   try
+   {
+      Board::Builder builder;
+      builder.FromFile(filename);
+      initial = builder.Build();
+   }
+   catch (const std::exception& aError)
+   {
+      std::cout << "wriggle: " << aError.what() << ", exiting" << std::endl;
+      return 1;
+   }
 
-   Board initial = builder.Build();
-   std::unique_ptr<Solver> solver;
+   std::shared_ptr<const PatternDatabase> patternDatabasePtr;
+   if (usePatternDatabase && !IsCached(initial))
+   {
+      patternDatabasePtr = LoadPatternDatabase(initial, patternDatabasePath);
+   }
 
-   switch (solverChoice[0])
+   std::unique_ptr<Solver> solver = Create(initial, patternDatabasePtr);
+   if (!solver)
    {
-   case 'b':
-      solver = std::make_unique<BreadthFirstTreeSearchSolver>(initial);
-      break;
-   case 'i':
-      solver = std::make_unique<IterativeDeepeningDepthFirstTreeSearchSolver>(initial);
-      break;
-   case 'g':
-      solver = std::make_unique<GreedyBestFirstGraphSearchSolver>(initial);
-      break;
-   case 'a':
-      solver = std::make_unique<AStarSolver>(initial);
-      break;
-   default:
       std::cout << "wriggle: solver not implemented yet, exiting" << std::endl;
       return 0;
-      break;
    }
       
    solver->Exec();
-   solver->PrintToStream(std::cout);
+   const int solutionLength = solver->IsSolved() ? static_cast<int>(solver->GetSolutionMoves()->size()) : 0;
+   if (statsFormat == "json")
+   {
+      solver->PrintJson(std::cout);
+      std::cout << std::endl;
+   }
+   else
+   {
+      solver->PrintToStream(std::cout);
+   }
+
+   // reported apart from the solution so its format stays the same
+   if (solver->IsLimitReached())
+   {
+      std::cerr << "wriggle: " << Solver::GetStopReasonName(solver->GetStopReason()) << " reached" << std::endl;
+   }
+   if (const SolutionCache::Entry* hitPtr = solver->GetCacheHit())
+   {
+      std::cerr << "wriggle: cached solution of " << hitPtr->mSolver << (hitPtr->mOptimal ? ", optimal," : "")
+         << " found in " << hitPtr->mWallTime.count() << " ns" << std::endl;
+   }
+   if (statsFormat == "text")
+   {
+      solver->GetStats().PrintToStream(std::cerr, solutionLength);
+   }
+   if (const auto* portfolioPtr = dynamic_cast<const PortfolioSolver*>(solver.get()))
+   {
+      const Solver* winnerPtr = portfolioPtr->GetWinner();
+      if (winnerPtr)
+      {
+         std::cerr << "wriggle: " << winnerPtr->GetName() << " won in "
+            << winnerPtr->GetWallTime().count() << " ns" << std::endl;
+      }
+      else
+      {
+         std::cerr << "wriggle: no solver found a solution" << std::endl;
+      }
+   }
 
    return 0;
 }
@@ -3,9 +3,22 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <climits>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
 
+#include "BatchRunner.hpp"
 #include "Board.hpp"
+#include "CommandLine.hpp"
+#include "ParallelSolver.hpp"
+#include "PatternDatabase.hpp"
+#include "SolutionCache.hpp"
 #include "Solver.hpp"
@@ -0,0 +1,300 @@
+// wriggle_bench.cpp : micro-benchmarks of the board primitives the
+// solvers spend their time in.
+//
+// usage: wriggle_bench [<puzzle file>...] [--min-time=<ms>]
+// without puzzle files the boards in WRIGGLE_PUZZLE_DIR are used, plus a
+// few synthetic large boards
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "Board.hpp"
+
+namespace
+{
+// keeps results alive so the compiler cannot drop the work
+volatile std::uint64_t gSink = 0;
+
+std::chrono::milliseconds gMinTime{ 200 };
+
+// runs aBatch, which does aOpsPerBatch operations, until gMinTime has
+// passed, and reports the time per operation
+void Measure(const std::string& aBoardName, const std::string& aName, const size_t aOpsPerBatch,
+   const std::function<void()>& aBatch)
+{
+   using clock = std::chrono::steady_clock;
+
+   // warm up caches and branch predictors first
+   aBatch();
+
+   size_t batches = 0;
+   const auto start = clock::now();
+   auto elapsed = clock::duration::zero();
+   do
+   {
+      aBatch();
+      ++batches;
+      elapsed = clock::now() - start;
+   } while (elapsed < gMinTime);
+
+   const double ns = std::chrono::duration<double, std::nano>(elapsed).count() / (static_cast<double>(batches) * aOpsPerBatch);
+   std::printf("%-24s %-28s %12.2f %16.0f\n", aBoardName.c_str(), aName.c_str(), ns, 1e9 / ns);
+}
+
+// a w x h board with aNumSnakes snakes of aLength cells lying in every
+// other row, and short walls in between; the exit stays free
+Board SyntheticBoard(const int aWidth, const int aHeight, const int aNumSnakes, const int aLength)
+{
+   std::vector<std::string> rows(static_cast<size_t>(aHeight), std::string(static_cast<size_t>(aWidth), 'e'));
+   for (int y = 2; y < aHeight - 1; y += 4)
+   {
+      for (int x = 3; x < aWidth - 1; x += 5)
+      {
+         rows[y][x] = 'x';
+      }
+   }
+   for (int k = 0; k < aNumSnakes; ++k)
+   {
+      const int y = (2 * k + 1) % (aHeight - 1);
+      const int x0 = (k * 7) % (aWidth - aLength - 1);
+      rows[y][x0] = 'R';
+      for (int i = 1; i < aLength - 1; ++i)
+      {
+         rows[y][x0 + i] = '>';
+      }
+      rows[y][x0 + aLength - 1] = static_cast<char>('0' + k);
+   }
+
+   std::ostringstream text;
+   text << aWidth << ' ' << aHeight << ' ' << aNumSnakes << '\n';
+   for (const auto& row : rows)
+   {
+      for (const char c : row)
+      {
+         text << c << ' ';
+      }
+      text << '\n';
+   }
+
+   std::istringstream in{ text.str() };
+   Board::Builder builder;
+   builder.FromStream(in);
+   return builder.Build();
+}
+
+// up to aCount distinct boards reachable from aInitial, breadth first
+std::vector<Board> ReachableBoards(const Board& aInitial, const size_t aCount)
+{
+   std::vector<Board> boards{ aInitial };
+   std::unordered_set<Board> seen{ aInitial };
+   for (size_t i = 0; i < boards.size() && boards.size() < aCount; ++i)
+   {
+      const Board current = boards[i];
+      for (const auto& move : current.LegalMoves())
+      {
+         Board next = current;
+         next.MakeMove(move);
+         if (seen.insert(next).second)
+         {
+            boards.push_back(next);
+            if (boards.size() == aCount)
+            {
+               break;
+            }
+         }
+      }
+   }
+   return boards;
+}
+
+void BenchBoard(const std::string& aName, const Board& aInitial)
+{
+   // the puzzle loaded from memory in both formats
+   std::ostringstream text;
+   aInitial.WriteText(text);
+   const std::string textData = text.str();
+   std::ostringstream binary;
+   aInitial.WriteBinary(binary);
+   const std::string binaryData = binary.str();
+
+   Measure(aName, "load text", 1, [&]()
+   {
+      Board::Builder builder;
+      builder.FromText(textData.data(), textData.data() + textData.size());
+      gSink = gSink + builder.Build().Hash();
+   });
+
+   Measure(aName, "load binary", 1, [&]()
+   {
+      Board::Builder builder;
+      builder.FromBinary(binaryData.data(), binaryData.size());
+      gSink = gSink + builder.Build().Hash();
+   });
+
+   const std::vector<Board> boards = ReachableBoards(aInitial, 4096);
+   const size_t count = boards.size();
+
+   Measure(aName, "LegalMoves", count, [&]()
+   {
+      for (const auto& board : boards)
+      {
+         gSink = gSink + board.LegalMoves().size();
+      }
+   });
+
+   std::vector<Board::Move> moves;
+   Measure(aName, "LegalMoves (reused vector)", count, [&]()
+   {
+      for (const auto& board : boards)
+      {
+         moves.clear();
+         board.LegalMoves(moves);
+         gSink = gSink + moves.size();
+      }
+   });
+
+   // every legal move of every board, made and taken back in place
+   std::vector<Board> scratch = boards;
+   std::vector<std::vector<Board::Move>> legal;
+   size_t moveCount = 0;
+   for (const auto& board : boards)
+   {
+      legal.push_back(board.LegalMoves());
+      moveCount += legal.back().size();
+   }
+   if (moveCount > 0)
+   {
+      Measure(aName, "MakeMove + UnmakeMove", moveCount, [&]()
+      {
+         for (size_t i = 0; i < count; ++i)
+         {
+            for (const auto& move : legal[i])
+            {
+               const int vacated = scratch[i].MakeMove(move);
+               scratch[i].UnmakeMove(move, vacated);
+            }
+         }
+      });
+
+      Board child = aInitial;
+      Measure(aName, "copy + MakeMove", moveCount, [&]()
+      {
+         for (size_t i = 0; i < count; ++i)
+         {
+            for (const auto& move : legal[i])
+            {
+               child = boards[i];
+               gSink = gSink + static_cast<std::uint64_t>(child.MakeMove(move));
+            }
+         }
+      });
+   }
+
+   Measure(aName, "Hash", count, [&]()
+   {
+      for (const auto& board : boards)
+      {
+         gSink = gSink ^ board.Hash();
+      }
+   });
+
+   // every location inside the board against every snake
+   const BoardLayout& layout = aInitial.GetLayout();
+   const int numSnakes = static_cast<int>(aInitial.GetStateBytes() / sizeof(Snake));
+   std::vector<Location> locations;
+   for (int y = 0; y < layout.GetSize().GetY(); ++y)
+   {
+      for (int x = 0; x < layout.GetSize().GetX(); ++x)
+      {
+         locations.push_back({ x, y });
+      }
+   }
+   Measure(aName, "Snake::OccupiesLocation", locations.size() * numSnakes, [&]()
+   {
+      for (int s = 0; s < numSnakes; ++s)
+      {
+         const Snake& snake = aInitial.GetSnake(s);
+         for (const auto& loc : locations)
+         {
+            gSink = gSink + (snake.OccupiesLocation(loc) ? 1 : 0);
+         }
+      }
+   });
+
+   std::unordered_set<Board> set;
+   Measure(aName, "unordered_set<Board> insert", count, [&]()
+   {
+      set.clear();
+      for (const auto& board : boards)
+      {
+         set.insert(board);
+      }
+      gSink = gSink + set.size();
+   });
+
+   Measure(aName, "unordered_set<Board> find", count, [&]()
+   {
+      for (const auto& board : boards)
+      {
+         gSink = gSink + (set.find(board) != set.end() ? 1 : 0);
+      }
+   });
+}
+}
+
+int main(int argc, char* argv[])
+{
+   std::vector<std::string> paths;
+   for (int i = 1; i < argc; ++i)
+   {
+      const std::string arg = argv[i];
+      const std::string minTime = "--min-time=";
+      if (arg.compare(0, minTime.size(), minTime) == 0)
+      {
+         gMinTime = std::chrono::milliseconds{ std::max(1, std::stoi(arg.substr(minTime.size()))) };
+      }
+      else
+      {
+         paths.push_back(arg);
+      }
+   }
+
+   const bool synthetic = paths.empty();
+   if (synthetic)
+   {
+      for (const auto& entry : std::filesystem::directory_iterator{ WRIGGLE_PUZZLE_DIR })
+      {
+         if (entry.is_regular_file())
+         {
+            paths.push_back(entry.path().string());
+         }
+      }
+      std::sort(paths.begin(), paths.end());
+   }
+
+   std::printf("%-24s %-28s %12s %16s\n", "board", "benchmark", "ns/op", "ops/s");
+   for (const auto& path : paths)
+   {
+      Board::Builder builder;
+      builder.FromFile(path);
+      BenchBoard(std::filesystem::path{ path }.filename().string(), builder.Build());
+   }
+
+   if (synthetic)
+   {
+      BenchBoard("synthetic 32x32", SyntheticBoard(32, 32, 6, 5));
+      BenchBoard("synthetic 64x64", SyntheticBoard(64, 64, 10, 8));
+      BenchBoard("synthetic 128x128", SyntheticBoard(128, 128, 10, 12));
+   }
+
+   return 0;
+}
@@ -0,0 +1,73 @@
+// wriggle_convert.cpp : converts puzzles between the text format and the
+// binary format of Board::WriteBinary.
+//
+// usage: wriggle_convert <input> <output>
+// the input may be in either format; the output is binary if its name
+// ends in .wpz and text otherwise
+
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "Board.hpp"
+
+namespace
+{
+const std::string BINARY_EXTENSION = ".wpz";
+
+bool IsBinaryPath(const std::string& aPath)
+{
+   return aPath.size() >= BINARY_EXTENSION.size()
+      && aPath.compare(aPath.size() - BINARY_EXTENSION.size(), BINARY_EXTENSION.size(), BINARY_EXTENSION) == 0;
+}
+}
+
+int main(int argc, char* argv[])
+{
+   if (argc != 3)
+   {
+      std::cout << "usage: wriggle_convert <input> <output[.wpz]>" << std::endl;
+      return 1;
+   }
+
+   Board board;
+   try
+   {
+      Board::Builder builder;
+      builder.FromFile(argv[1]);
+      board = builder.Build();
+   }
+   catch (const std::exception& aError)
+   {
+      std::cerr << "wriggle_convert: " << argv[1] << ": " << aError.what() << std::endl;
+      return 1;
+   }
+
+   const std::string outPath = argv[2];
+   if (!IsBinaryPath(outPath) && !board.FitsText())
+   {
+      std::cerr << "wriggle_convert: " << argv[1] << " has more than " << Board::MaxTextSnakes
+         << " snakes, which only fit the binary format" << std::endl;
+      return 1;
+   }
+
+   std::ofstream out;
+   if (IsBinaryPath(outPath))
+   {
+      out.open(outPath, std::ios::binary);
+      board.WriteBinary(out);
+   }
+   else
+   {
+      out.open(outPath);
+      board.WriteText(out);
+   }
+
+   if (!out)
+   {
+      std::cerr << "wriggle_convert: could not write " << outPath << std::endl;
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,377 @@
+// wriggle_gen.cpp : writes random puzzles in the text format wriggle
+// reads, for load and scaling tests. puzzles of more snakes than the text
+// format holds are written in the binary format instead.
+//
+// usage: wriggle_gen [--width=<n>] [--height=<n>] [--snakes=<n>]
+//    [--length=<n>[-<m>]] [--walls=<density>] [--moves=<n>]
+//    [--min-distance=<n>] [--seed=<n>] [--count=<n>] [--out=<file|dir>]
+// one puzzle goes to stdout or the --out file; with --count, each puzzle
+// goes to its own file in the --out directory, named after its settings,
+// ready for wriggle --batch
+//
+// a puzzle starts out solved, with the 0-snake on the exit, and is then
+// scrambled with random legal moves; moves can always be taken back, so
+// every puzzle written can be solved. the scramble prefers moves taking
+// the 0-snake away from the exit, and a puzzle is kept only if the 0-snake
+// ends at least --min-distance moves from it
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <climits>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "Board.hpp"
+#include "CommandLine.hpp"
+#include "Solver.hpp"
+
+namespace
+{
+struct Options
+{
+   int mWidth = 8;
+   int mHeight = 8;
+   int mNumSnakes = 4;
+   int mMinLength = 2;
+   int mMaxLength = 4;
+   double mWallDensity = 0.1;
+   int mScrambleMoves = 1000;
+
+   // fewest moves the 0-snake must need to reach the exit, by
+   // Solver::ExitLowerBound
+   int mMinDistance = 1;
+   int mCount = 1;
+   unsigned long long mSeed = 1;
+   std::string mOut;
+};
+
+const char* const USAGE = "usage: wriggle_gen [--width=<n>] [--height=<n>] [--snakes=<n>] [--length=<n>[-<m>]] [--walls=<density>] [--moves=<n>] [--min-distance=<n>] [--seed=<n>] [--count=<n>] [--out=<file|dir>]";
+
+// the text of every cell, row by row
+using Grid = std::vector<std::vector<std::string>>;
+
+// a random self-avoiding walk of aLength cells from aStart over the free
+// cells of aGrid, written into it as a snake; returns false if the walk
+// got stuck
+bool PlaceSnake(Grid& aGrid, const Location& aStart, const int aLength, const int aIdx, std::mt19937_64& aRng)
+{
+   const std::array<Direction, 4> directions = { Direction::Up, Direction::Right, Direction::Down, Direction::Left };
+   const std::array<const char*, 4> headTokens = { "U", "R", "D", "L" };
+   const std::array<const char*, 4> bodyTokens = { "^", ">", "v", "<" };
+   const int height = static_cast<int>(aGrid.size());
+   const int width = static_cast<int>(aGrid.front().size());
+
+   auto IsFree = [&](const Location& aLoc, const std::vector<Location>& aPath)
+   {
+      return aLoc.GetX() >= 0 && aLoc.GetX() < width && aLoc.GetY() >= 0 && aLoc.GetY() < height
+         && aGrid[aLoc.GetY()][aLoc.GetX()] == "e" && std::find(aPath.begin(), aPath.end(), aLoc) == aPath.end();
+   };
+
+   if (!IsFree(aStart, {}))
+   {
+      return false;
+   }
+
+   std::vector<Location> path{ aStart };
+   std::vector<int> links;
+   while (static_cast<int>(path.size()) < aLength)
+   {
+      std::vector<int> open;
+      for (int dir = 0; dir < 4; ++dir)
+      {
+         if (IsFree(path.back().Nudge(directions[dir]), path))
+         {
+            open.push_back(dir);
+         }
+      }
+      if (open.empty())
+      {
+         return false;
+      }
+      const int dir = open[std::uniform_int_distribution<size_t>{ 0, open.size() - 1 }(aRng)];
+      links.push_back(dir);
+      path.push_back(path.back().Nudge(directions[dir]));
+   }
+
+   for (size_t i = 0; i < links.size(); ++i)
+   {
+      aGrid[path[i].GetY()][path[i].GetX()] = i == 0 ? headTokens[links[i]] : bodyTokens[links[i]];
+   }
+   aGrid[path.back().GetY()][path.back().GetX()] = std::to_string(aIdx);
+   return true;
+}
+
+// a solved board: walls at random, the 0-snake starting on the exit and
+// the others anywhere they fit
+Board SolvedBoard(const Options& aOptions, std::mt19937_64& aRng)
+{
+   const int width = aOptions.mWidth;
+   const int height = aOptions.mHeight;
+   const Location exit{ width - 1, height - 1 };
+   std::uniform_int_distribution<int> lengths{ aOptions.mMinLength, aOptions.mMaxLength };
+   std::uniform_int_distribution<int> xs{ 0, width - 1 };
+   std::uniform_int_distribution<int> ys{ 0, height - 1 };
+   std::bernoulli_distribution isWall{ aOptions.mWallDensity };
+
+   const int attempts = 1000;
+   for (int attempt = 0; attempt < attempts; ++attempt)
+   {
+      Grid grid(static_cast<size_t>(height), std::vector<std::string>(static_cast<size_t>(width), "e"));
+      for (int y = 0; y < height; ++y)
+      {
+         for (int x = 0; x < width; ++x)
+         {
+            if (Location{ x, y } != exit && isWall(aRng))
+            {
+               grid[y][x] = "x";
+            }
+         }
+      }
+
+      bool placed = PlaceSnake(grid, exit, lengths(aRng), 0, aRng);
+      for (int idx = 1; placed && idx < aOptions.mNumSnakes; ++idx)
+      {
+         placed = false;
+         for (int tries = 0; !placed && tries < attempts; ++tries)
+         {
+            placed = PlaceSnake(grid, { xs(aRng), ys(aRng) }, lengths(aRng), idx, aRng);
+         }
+      }
+      if (!placed)
+      {
+         continue;
+      }
+
+      std::ostringstream text;
+      text << width << ' ' << height << ' ' << aOptions.mNumSnakes << '\n';
+      for (const auto& row : grid)
+      {
+         for (const auto& cell : row)
+         {
+            text << cell << ' ';
+         }
+         text << '\n';
+      }
+
+      std::istringstream in{ text.str() };
+      Board::Builder builder;
+      builder.FromStream(in);
+      return builder.Build();
+   }
+
+   throw std::runtime_error("could not fit the snakes on the board");
+}
+
+// random legal moves until the scramble count is made and the 0-snake is
+// at least the minimum distance from the exit; boards not seen before are
+// preferred, so the walk drifts away from the solved board instead of
+// circling it. returns false if the 0-snake cannot be moved far enough
+bool Scramble(Board& aBoard, const Options& aOptions, std::mt19937_64& aRng)
+{
+   std::vector<Board::Move> moves;
+   std::unordered_set<Board> seen{ aBoard };
+   const int maxMoves = 10 * aOptions.mScrambleMoves + 1000;
+   int distance = Solver::ExitLowerBound(aBoard);
+   for (int made = 0; made < aOptions.mScrambleMoves || distance < aOptions.mMinDistance; ++made)
+   {
+      moves.clear();
+      aBoard.LegalMoves(moves);
+      if (moves.empty() || made == maxMoves)
+      {
+         return false;
+      }
+
+      // moves of the 0-snake away from the exit go first; with uniform
+      // moves the 0-snake wanders back and most puzzles end up a few moves
+      // from solved
+      std::shuffle(moves.begin(), moves.end(), aRng);
+      std::stable_partition(moves.begin(), moves.end(), [&aBoard, distance](const Board::Move& aMove)
+      {
+         if (aMove.mSnakeIdx != 0)
+         {
+            return false;
+         }
+         Board next = aBoard;
+         next.MakeMove(aMove);
+         return Solver::ExitLowerBound(next) > distance;
+      });
+      Board next = aBoard;
+      for (const auto& move : moves)
+      {
+         next = aBoard;
+         next.MakeMove(move);
+         if (seen.insert(next).second)
+         {
+            break;
+         }
+      }
+      aBoard = next;
+      distance = Solver::ExitLowerBound(aBoard);
+   }
+   return true;
+}
+
+// a solved board scrambled; boards the scramble gets stuck on are dropped
+Board Generate(const Options& aOptions, std::mt19937_64& aRng)
+{
+   const int attempts = 100;
+   for (int attempt = 0; attempt < attempts; ++attempt)
+   {
+      Board board = SolvedBoard(aOptions, aRng);
+      if (Scramble(board, aOptions, aRng))
+      {
+         return board;
+      }
+   }
+
+   throw std::runtime_error("could not move the 0-snake far enough from the exit");
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+   // the ranges are checked below, so values only have to be numbers here
+   Options options;
+   bool valid = true;
+   for (int i = 1; valid && i < argc; ++i)
+   {
+      std::string value;
+      if (ParseOption(argv[i], "width", value))
+      {
+         valid = ReadNumber(value, INT_MIN, INT_MAX, options.mWidth);
+      }
+      else if (ParseOption(argv[i], "height", value))
+      {
+         valid = ReadNumber(value, INT_MIN, INT_MAX, options.mHeight);
+      }
+      else if (ParseOption(argv[i], "snakes", value))
+      {
+         valid = ReadNumber(value, INT_MIN, INT_MAX, options.mNumSnakes);
+      }
+      else if (ParseOption(argv[i], "length", value))
+      {
+         // a single length, or a range min-max
+         const size_t dash = value.find('-');
+         valid = ReadNumber(value.substr(0, dash), INT_MIN, INT_MAX, options.mMinLength);
+         options.mMaxLength = options.mMinLength;
+         if (valid && dash != std::string::npos)
+         {
+            valid = ReadNumber(value.substr(dash + 1), INT_MIN, INT_MAX, options.mMaxLength);
+         }
+      }
+      else if (ParseOption(argv[i], "walls", value))
+      {
+         valid = ReadNumber(value, -DBL_MAX, DBL_MAX, options.mWallDensity);
+      }
+      else if (ParseOption(argv[i], "moves", value))
+      {
+         valid = ReadNumber(value, 0, INT_MAX, options.mScrambleMoves);
+      }
+      else if (ParseOption(argv[i], "min-distance", value))
+      {
+         valid = ReadNumber(value, 1, INT_MAX, options.mMinDistance);
+      }
+      else if (ParseOption(argv[i], "seed", value))
+      {
+         valid = ReadNumber(value, 0ull, ULLONG_MAX, options.mSeed);
+      }
+      else if (ParseOption(argv[i], "count", value))
+      {
+         valid = ReadNumber(value, INT_MIN, INT_MAX, options.mCount);
+      }
+      else if (ParseOption(argv[i], "out", value))
+      {
+         options.mOut = value;
+      }
+      else
+      {
+         valid = false;
+      }
+   }
+   if (!valid)
+   {
+      std::cout << USAGE << std::endl;
+      return 1;
+   }
+
+   if (options.mWidth < 1 || options.mHeight < 1 || (options.mWidth == 1 && options.mHeight == 1)
+      || options.mNumSnakes < 1 || options.mNumSnakes > Board::MaxSnakes
+      || options.mMinLength < 2 || options.mMaxLength < options.mMinLength
+      || options.mWallDensity < 0.0 || options.mWallDensity >= 1.0 || options.mCount < 1)
+   {
+      std::cerr << "wriggle_gen: need a board of 2 cells or more, 1 to " << Board::MaxSnakes
+         << " snakes of 2 cells or more, a wall density below 1 and a count of 1 or more" << std::endl;
+      return 1;
+   }
+
+   // several puzzles go to a directory, one file each
+   if (options.mCount > 1 && options.mOut.empty())
+   {
+      options.mOut = ".";
+   }
+
+   std::mt19937_64 rng{ options.mSeed };
+   for (int i = 0; i < options.mCount; ++i)
+   {
+      Board board;
+      try
+      {
+         board = Generate(options, rng);
+      }
+      catch (const std::exception& aError)
+      {
+         std::cerr << "wriggle_gen: " << aError.what() << std::endl;
+         return 1;
+      }
+
+      // tails past Board::MaxTextSnakes do not fit the text format
+      const bool binary = !board.FitsText();
+      if (options.mOut.empty() && binary)
+      {
+         board.WriteBinary(std::cout);
+         continue;
+      }
+      else if (options.mOut.empty())
+      {
+         board.WriteText(std::cout);
+         continue;
+      }
+
+      std::filesystem::path path{ options.mOut };
+      if (options.mCount > 1)
+      {
+         std::filesystem::create_directories(path);
+         std::ostringstream name;
+         name << "puzzle_" << options.mWidth << 'x' << options.mHeight << '_' << options.mNumSnakes << "s_"
+            << options.mSeed << '_' << i << (binary ? ".wpz" : ".txt");
+         path /= name.str();
+      }
+      std::ofstream out;
+      if (binary)
+      {
+         out.open(path, std::ios::binary);
+         board.WriteBinary(out);
+      }
+      else
+      {
+         out.open(path);
+         board.WriteText(out);
+      }
+      if (!out)
+      {
+         std::cerr << "wriggle_gen: could not write " << path.string() << std::endl;
+         return 1;
+      }
+   }
+
+   return 0;
+}